@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "arena.h"
+
+Arena *combat_zone;
+volatile sig_atomic_t holding_arena;
+int arena_owner = COORDINATOR_OWNER;
+void (*arena_recovered)(void);
+
+void arena_set_owner(int owner, void (*on_recover)(void)) {
+    arena_owner = owner;
+    arena_recovered = on_recover;
+}
+
+void recover_arena() {
+    int dead_owner = combat_zone->lock_owner;
+
+    if (dead_owner >= 0 && dead_owner < combat_zone->total_count) {
+        combat_zone->fighters[dead_owner].connected = 0;
+        printf("Боец %d завершился, удерживая арену.\n", dead_owner);
+    }
+    if (arena_recovered) {
+        arena_recovered();
+    }
+}
+
+unsigned long long pack_state(int active, int rival, int slot, unsigned int version) {
+    unsigned long long state = (unsigned long long)version << STATE_VERSION_SHIFT;
+    if (active) {
+        state |= STATE_ACTIVE;
+    }
+    if (rival >= 0) {
+        state |= STATE_ENGAGED |
+                 (unsigned long long)rival << STATE_RIVAL_SHIFT |
+                 (unsigned long long)slot << STATE_SLOT_SHIFT;
+    }
+    return state;
+}
+
+int state_active(unsigned long long state) {
+    return (state & STATE_ACTIVE) != 0;
+}
+
+int state_rival(unsigned long long state) {
+    return state & STATE_ENGAGED ? (int)((state >> STATE_RIVAL_SHIFT) & 0xff) : -1;
+}
+
+int state_slot(unsigned long long state) {
+    return state & STATE_ENGAGED ? (int)((state >> STATE_SLOT_SHIFT) & 0xff) : -1;
+}
+
+unsigned long long load_state(int fighter) {
+    return __atomic_load_n(&combat_zone->fighters[fighter].state, __ATOMIC_ACQUIRE);
+}
+
+int change_state(int fighter, unsigned long long expected, int active, int rival, int slot) {
+    unsigned long long desired = pack_state(active, rival, slot, (unsigned int)(expected >> STATE_VERSION_SHIFT) + 1);
+    return __atomic_compare_exchange_n(&combat_zone->fighters[fighter].state, &expected, desired, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+int eliminate_fighter(int loser, int winner, int node) {
+    unsigned long long state = load_state(loser);
+    while (state_active(state) && state_slot(state) == node) {
+        if (change_state(loser, state, 0, -1, -1)) {
+            __atomic_add_fetch(&combat_zone->fighters[winner].victories, 1, __ATOMIC_RELAXED);
+            __atomic_sub_fetch(&combat_zone->alive_count, 1, __ATOMIC_ACQ_REL);
+            return 1;
+        }
+        state = load_state(loser);
+    }
+    return 0;
+}
+
+void release_fighter(int fighter, int node) {
+    unsigned long long state = load_state(fighter);
+    while (state_active(state) && state_slot(state) == node) {
+        if (change_state(fighter, state, 1, -1, -1)) {
+            return;
+        }
+        state = load_state(fighter);
+    }
+}
+
+void begin_commit() {
+    __atomic_add_fetch(&combat_zone->commits_begun, 1, __ATOMIC_SEQ_CST);
+}
+
+void end_commit() {
+    __atomic_add_fetch(&combat_zone->commits_done, 1, __ATOMIC_RELEASE);
+}
+
+int commit_outcome(int node, int winner, int loser) {
+    int expected = BRACKET_PENDING;
+    begin_commit();
+    if (!__atomic_compare_exchange_n(&combat_zone->bracket[node], &expected, winner, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        end_commit();
+        return 0;
+    }
+    eliminate_fighter(loser, winner, node);
+    release_fighter(winner, node);
+    end_commit();
+    return 1;
+}
+
+void arena_lock() {
+    int result = EBUSY;
+    for (int spin = 0; spin < ARENA_LOCK_SPINS && result == EBUSY; spin++) {
+        result = pthread_mutex_trylock(&combat_zone->lock);
+    }
+    if (result == EBUSY) {
+        result = pthread_mutex_lock(&combat_zone->lock);
+    }
+
+    if (result == EOWNERDEAD) {
+        recover_arena();
+        pthread_mutex_consistent(&combat_zone->lock);
+    }
+
+    unsigned int seq = combat_zone->seq;
+    __atomic_store_n(&combat_zone->seq, seq + (seq & 1 ? 2 : 1), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    combat_zone->lock_owner = arena_owner;
+    holding_arena = 1;
+}
+
+void arena_unlock() {
+    __atomic_store_n(&combat_zone->seq, combat_zone->seq + 1, __ATOMIC_RELEASE);
+    holding_arena = 0;
+    pthread_mutex_unlock(&combat_zone->lock);
+}
+
+int copy_between_commits(Arena *view) {
+    unsigned int commits = __atomic_load_n(&combat_zone->commits_begun, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&combat_zone->commits_done, __ATOMIC_ACQUIRE) != commits) {
+        return 0;
+    }
+    memcpy(view, combat_zone, sizeof(Arena));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&combat_zone->commits_begun, __ATOMIC_RELAXED) == commits;
+}
+
+void read_arena(Arena *view) {
+    for (int attempt = 0; attempt < SEQLOCK_RETRIES; attempt++) {
+        unsigned int begin = __atomic_load_n(&combat_zone->seq, __ATOMIC_ACQUIRE);
+        if (!(begin & 1) && copy_between_commits(view) &&
+            __atomic_load_n(&combat_zone->seq, __ATOMIC_RELAXED) == begin) {
+            return;
+        }
+        sched_yield();
+    }
+
+    arena_lock();
+    int copied = 0;
+    for (int attempt = 0; attempt < SEQLOCK_RETRIES && !copied; attempt++) {
+        copied = copy_between_commits(view);
+        if (!copied) {
+            sched_yield();
+        }
+    }
+    if (!copied) {
+        memcpy(view, combat_zone, sizeof(Arena));
+    }
+    arena_unlock();
+}
+
+int duel_abandoned(int fighter_id, int slot) {
+    return __atomic_load_n(&combat_zone->finished, __ATOMIC_ACQUIRE) ||
+           __atomic_load_n(&combat_zone->terminated, __ATOMIC_ACQUIRE) ||
+           __atomic_load_n(&combat_zone->bracket[slot], __ATOMIC_ACQUIRE) != BRACKET_PENDING ||
+           state_slot(load_state(fighter_id)) != slot;
+}
+
+void publish_move(DuelMailbox *box, int side, unsigned int exchange, HandSign move) {
+    unsigned int *word = &box->moves[side][exchange & 1];
+    __atomic_store_n(word, exchange << MAILBOX_EXCHANGE_SHIFT | move, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&box->sleeping[1 - side], __ATOMIC_SEQ_CST)) {
+        futex(word, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+int await_rival(DuelMailbox *box, int side, unsigned int exchange, int spins, int fighter_id, int slot) {
+    unsigned int *word = &box->moves[1 - side][exchange & 1];
+    for (int spin = 0; spin < spins; spin++) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) >> MAILBOX_EXCHANGE_SHIFT == exchange) {
+            return 1;
+        }
+    }
+
+    for (int waits = 0; waits < MAILBOX_TIMEOUT_WAITS; waits++) {
+        __atomic_store_n(&box->sleeping[side], 1, __ATOMIC_SEQ_CST);
+        unsigned int seen = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+        if (seen >> MAILBOX_EXCHANGE_SHIFT != exchange && !duel_abandoned(fighter_id, slot)) {
+            struct timespec timeout = {0, 100000000};
+            futex(word, FUTEX_WAIT, seen, &timeout);
+            seen = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+        }
+        __atomic_store_n(&box->sleeping[side], 0, __ATOMIC_RELAXED);
+
+        if (seen >> MAILBOX_EXCHANGE_SHIFT == exchange) {
+            return 1;
+        }
+        if (duel_abandoned(fighter_id, slot)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int slot_round(int slot) {
+    int round = 0;
+    for (int width = combat_zone->bracket_size; width > slot; width >>= 1) {
+        round++;
+    }
+    return round;
+}
+
+long futex(unsigned int *word, int op, unsigned int value, const struct timespec *timeout) {
+    return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
@@ -0,0 +1,104 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "gesture.h"
+#include "strategy.h"
+
+#define MAX_FIGHTERS 32
+#define CACHE_LINE_SIZE 64
+#define SHM_NAME "/battle_arena_10"
+#define FIGHTER_NAME_SIZE 32
+#define BRACKET_PENDING -1
+#define BRACKET_BYE -2
+#define COORDINATOR_OWNER -1
+#define ARENA_LOCK_SPINS 100
+#define SEQLOCK_RETRIES 100
+#define STATE_ACTIVE 1ULL
+#define STATE_ENGAGED 2ULL
+#define STATE_RIVAL_SHIFT 8
+#define STATE_SLOT_SHIFT 16
+#define STATE_VERSION_SHIFT 32
+#define HUGE_ZONE_PATH "/dev/hugepages/battle_arena_10"
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define ZONE_MAP_HUGETLB 1
+#define ZONE_MAP_THP 2
+#define ZONE_MAP_POPULATE 4
+#define ZONE_MAP_LOCK 8
+#define MAILBOX_SPINS 2000
+#define MAILBOX_TIMEOUT_WAITS 50
+#define MAILBOX_EXCHANGE_SHIFT 8
+#define MAILBOX_MOVE_MASK 0xff
+
+typedef struct {
+    unsigned long long state;
+    int victories;
+    HandSign gesture;
+    int connected;
+    HandSign submitted;
+    unsigned int submitted_turn;
+} __attribute__((aligned(CACHE_LINE_SIZE))) Combatant;
+
+typedef struct {
+    unsigned int moves[2][2];
+    unsigned int sleeping[2];
+} __attribute__((aligned(CACHE_LINE_SIZE))) DuelMailbox;
+
+typedef struct {
+    Combatant fighters[MAX_FIGHTERS];
+    DuelMailbox mailboxes[MAX_FIGHTERS];
+    MoveHistory histories[MAX_FIGHTERS];
+    char names[MAX_FIGHTERS][FIGHTER_NAME_SIZE];
+    unsigned int tournament_id;
+    int bracket[2 * MAX_FIGHTERS];
+    int bracket_size;
+    int total_count;
+    int alive_count;
+    int round_num;
+    int finished;
+    int terminated;
+    unsigned int generation;
+    unsigned int heartbeat;
+    pid_t coordinator_pid;
+    unsigned int map_options;
+    int referee;
+    int gesture_count;
+    unsigned int referee_turn __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned long long referee_pending;
+    pthread_mutex_t lock __attribute__((aligned(CACHE_LINE_SIZE)));
+    int lock_owner;
+    unsigned int seq;
+    unsigned int commits_begun __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned int commits_done;
+} Arena;
+
+extern Arena *combat_zone;
+extern volatile sig_atomic_t holding_arena;
+
+void arena_set_owner(int owner, void (*on_recover)(void));
+unsigned long long pack_state(int active, int rival, int slot, unsigned int version);
+int state_active(unsigned long long state);
+int state_rival(unsigned long long state);
+int state_slot(unsigned long long state);
+unsigned long long load_state(int fighter);
+int change_state(int fighter, unsigned long long expected, int active, int rival, int slot);
+int eliminate_fighter(int loser, int winner, int node);
+void release_fighter(int fighter, int node);
+void begin_commit();
+void end_commit();
+int commit_outcome(int node, int winner, int loser);
+void arena_lock();
+void arena_unlock();
+int copy_between_commits(Arena *view);
+void read_arena(Arena *view);
+int duel_abandoned(int fighter_id, int slot);
+void publish_move(DuelMailbox *box, int side, unsigned int exchange, HandSign move);
+int await_rival(DuelMailbox *box, int side, unsigned int exchange, int spins, int fighter_id, int slot);
+int slot_round(int slot);
+long futex(unsigned int *word, int op, unsigned int value, const struct timespec *timeout);
+
+#endif
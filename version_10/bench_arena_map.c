@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "arena.h"
+
+#define DEFAULT_MEGABYTES 512
+#define DEFAULT_SCANS 3
+
+typedef enum {
+    MAPPING_PLAIN,
+    MAPPING_POPULATE,
+    MAPPING_THP,
+    MAPPING_HUGETLB
+} MappingMode;
+
+const char *mode_names[] = {
+    "обычное отображение",
+    "MAP_POPULATE",
+    "THP (MADV_HUGEPAGE)",
+    "hugetlb (MFD_HUGETLB)"
+};
+
+volatile long sink;
+
+double elapsed_ms(struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 + (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void print_thp_setting() {
+    char setting[128] = "неизвестно";
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/shmem_enabled", "r");
+    if (file) {
+        if (fgets(setting, sizeof(setting), file)) {
+            setting[strcspn(setting, "\n")] = '\0';
+        }
+        fclose(file);
+    }
+    printf("shmem_enabled: %s\n", setting);
+}
+
+void run_mode(MappingMode mode, size_t size, int scans) {
+    size_t count = size / sizeof(Arena);
+    size_t fighters = count * MAX_FIGHTERS;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int fd = memfd_create("battle_arena_bench", mode == MAPPING_HUGETLB ? MFD_HUGETLB : 0);
+    if (fd == -1 || ftruncate(fd, size) == -1) {
+        printf("%s: недоступно (%s)\n", mode_names[mode], strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    int flags = MAP_SHARED | (mode == MAPPING_POPULATE ? MAP_POPULATE : 0);
+    Arena *arenas = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    close(fd);
+    if (arenas == MAP_FAILED) {
+        printf("%s: недоступно (%s)\n", mode_names[mode], strerror(errno));
+        return;
+    }
+    if (mode == MAPPING_THP) {
+        madvise(arenas, size, MADV_HUGEPAGE);
+    }
+    double map_time = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t a = 0; a < count; a++) {
+        Arena *arena = &arenas[a];
+        arena->total_count = MAX_FIGHTERS;
+        arena->alive_count = MAX_FIGHTERS;
+        arena->bracket_size = MAX_FIGHTERS;
+        for (int i = 0; i < MAX_FIGHTERS; i++) {
+            arena->fighters[i].state = pack_state(1, i ^ 1, (MAX_FIGHTERS + i) / 2, 0);
+            arena->fighters[i].gesture = NO_GESTURE;
+            arena->bracket[MAX_FIGHTERS + i] = i;
+        }
+        for (int node = 1; node < MAX_FIGHTERS; node++) {
+            arena->bracket[node] = BRACKET_PENDING;
+        }
+    }
+    double first_round = elapsed_ms(&start);
+
+    long checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int scan = 0; scan < scans; scan++) {
+        for (size_t a = 0; a < count; a++) {
+            for (int i = 0; i < MAX_FIGHTERS; i++) {
+                checksum += state_active(arenas[a].fighters[i].state) + arenas[a].fighters[i].victories;
+            }
+        }
+    }
+    double scan_time = elapsed_ms(&start) / scans;
+
+    size_t mask = 1;
+    while (mask < fighters) {
+        mask <<= 1;
+    }
+    mask -= 1;
+    size_t index = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t step = 0; step < fighters; step++) {
+        index = (index * 1103515245 + 12345) & mask;
+        if (index < fighters) {
+            checksum += state_rival(arenas[index / MAX_FIGHTERS].fighters[index % MAX_FIGHTERS].state);
+        }
+    }
+    double random_time = elapsed_ms(&start);
+
+    sink = checksum;
+    printf("%s:\n  отображение %.2f мс, первый раунд %.2f мс, скан %.2f мс, случайный обход %.2f мс\n",
+           mode_names[mode], map_time, first_round, scan_time, random_time);
+    munmap(arenas, size);
+}
+
+int main(int argc, char *argv[]) {
+    long megabytes = argc > 1 ? atol(argv[1]) : DEFAULT_MEGABYTES;
+    int scans = argc > 2 ? atoi(argv[2]) : DEFAULT_SCANS;
+    if (megabytes < 2 || scans < 1) {
+        printf("Использовано %s [мегабайты] [сканирования].\n", argv[0]);
+        return 1;
+    }
+
+    size_t size = (size_t)megabytes * 1024 * 1024;
+    size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    printf("Арены: %zu МБ, %zu арен по %zu байт.\n", size >> 20, size / sizeof(Arena), sizeof(Arena));
+    print_thp_setting();
+
+    for (MappingMode mode = MAPPING_PLAIN; mode <= MAPPING_HUGETLB; mode++) {
+        run_mode(mode, size, scans);
+    }
+    return 0;
+}
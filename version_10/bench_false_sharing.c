@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+#define DEFAULT_PROCESSES 4
+#define DEFAULT_ITERATIONS 20000000
+
+typedef struct {
+    unsigned long long state;
+    int victories;
+    HandSign gesture;
+    int connected;
+    HandSign submitted;
+    unsigned int submitted_turn;
+} PackedCombatant;
+
+typedef struct {
+    PackedCombatant packed[MAX_FIGHTERS];
+    Combatant isolated[MAX_FIGHTERS];
+} BenchZone;
+
+typedef struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} CounterSpec;
+
+CounterSpec counter_specs[] = {
+    {"циклы", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"промахи кэша", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"промахи L1D", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}
+};
+
+#define COUNTERS (int)(sizeof(counter_specs) / sizeof(counter_specs[0]))
+
+BenchZone *zone;
+int counter_fds[COUNTERS];
+
+int open_counter(CounterSpec *spec) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec->type;
+    attr.config = spec->config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void duel_packed(int fighter, long iterations) {
+    volatile PackedCombatant *self = &zone->packed[fighter];
+    for (long i = 0; i < iterations; i++) {
+        self->gesture = (HandSign)(i % DEFAULT_GESTURES);
+        self->state = pack_state(1, (int)(i & 1) ? fighter ^ 1 : -1, 1, (unsigned int)i);
+        self->victories++;
+    }
+}
+
+void duel_isolated(int fighter, long iterations) {
+    volatile Combatant *self = &zone->isolated[fighter];
+    for (long i = 0; i < iterations; i++) {
+        self->gesture = (HandSign)(i % DEFAULT_GESTURES);
+        self->state = pack_state(1, (int)(i & 1) ? fighter ^ 1 : -1, 1, (unsigned int)i);
+        self->victories++;
+    }
+}
+
+void run_bench(const char *name, int isolated, int processes, long iterations) {
+    memset(zone, 0, sizeof(BenchZone));
+    for (int c = 0; c < COUNTERS; c++) {
+        if (counter_fds[c] != -1) {
+            ioctl(counter_fds[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter_fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    fflush(stdout);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int p = 0; p < processes; p++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (isolated) {
+                duel_isolated(p, iterations);
+            } else {
+                duel_packed(p, iterations);
+            }
+            exit(0);
+        } else if (pid < 0) {
+            perror("Проблема с созданием процесса.");
+            exit(1);
+        }
+    }
+    for (int p = 0; p < processes; p++) {
+        wait(NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    double operations = (double)processes * iterations;
+    printf("%s: %.2f нс/обновление\n", name, elapsed_ns / operations);
+
+    for (int c = 0; c < COUNTERS; c++) {
+        if (counter_fds[c] == -1) {
+            continue;
+        }
+        ioctl(counter_fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t value = 0;
+        if (read(counter_fds[c], &value, sizeof(value)) == sizeof(value)) {
+            printf("  %s: %.3f на обновление\n", counter_specs[c].name, value / operations);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int processes = argc > 1 ? atoi(argv[1]) : DEFAULT_PROCESSES;
+    long iterations = argc > 2 ? atol(argv[2]) : DEFAULT_ITERATIONS;
+    if (processes < 2 || processes > MAX_FIGHTERS || iterations < 1) {
+        printf("Использовано %s [процессы 2..%d] [итерации].\n", argv[0], MAX_FIGHTERS);
+        return 1;
+    }
+
+    zone = mmap(NULL, sizeof(BenchZone), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (zone == MAP_FAILED) {
+        perror("Проблема с отображением памяти.");
+        return 1;
+    }
+
+    int available = 0;
+    for (int c = 0; c < COUNTERS; c++) {
+        counter_fds[c] = open_counter(&counter_specs[c]);
+        available += counter_fds[c] != -1;
+    }
+    if (!available) {
+        printf("Счетчики perf недоступны (%s), измеряется только время.\n", strerror(errno));
+    }
+
+    printf("Процессов: %d, обновлений на процесс: %ld.\n", processes, iterations);
+    printf("Размер записи: %zu байт против %zu байт.\n", sizeof(PackedCombatant), sizeof(Combatant));
+    run_bench("Плотный массив", 0, processes, iterations);
+    run_bench("Строки кэша на бойца", 1, processes, iterations);
+
+    for (int c = 0; c < COUNTERS; c++) {
+        if (counter_fds[c] != -1) {
+            close(counter_fds[c]);
+        }
+    }
+    munmap(zone, sizeof(BenchZone));
+    return 0;
+}
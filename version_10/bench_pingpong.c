@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <semaphore.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+
+#define DEFAULT_ROUNDS 200000
+#define BENCH_SLOT 1
+
+typedef struct {
+    Arena arena;
+    sem_t turns[2];
+    unsigned int sem_moves[2];
+} BenchZone;
+
+BenchZone *zone;
+
+void play_mailbox(int side, int rounds, int spins) {
+    DuelMailbox *box = &combat_zone->mailboxes[BENCH_SLOT];
+    unsigned int checksum = 0;
+    for (int exchange = 1; exchange <= rounds; exchange++) {
+        publish_move(box, side, exchange, exchange % DEFAULT_GESTURES);
+        if (await_rival(box, side, exchange, spins, side, BENCH_SLOT) != 1) {
+            printf("Бой прерван на обмене %d.\n", exchange);
+            return;
+        }
+        checksum += __atomic_load_n(&box->moves[1 - side][exchange & 1], __ATOMIC_ACQUIRE) & MAILBOX_MOVE_MASK;
+    }
+    if (checksum == 0) {
+        printf("Пустой обмен.\n");
+    }
+}
+
+void play_semaphores(int side, int rounds) {
+    for (int exchange = 1; exchange <= rounds; exchange++) {
+        if (side == 0) {
+            zone->sem_moves[0] = exchange % 3;
+            sem_post(&zone->turns[1]);
+            sem_wait(&zone->turns[0]);
+        } else {
+            sem_wait(&zone->turns[1]);
+            zone->sem_moves[1] = exchange % 3;
+            sem_post(&zone->turns[0]);
+        }
+    }
+}
+
+double run_bench(int mode, int rounds) {
+    memset(&zone->arena, 0, sizeof(Arena));
+    zone->arena.total_count = 2;
+    zone->arena.alive_count = 2;
+    zone->arena.bracket_size = 2;
+    zone->arena.bracket[BENCH_SLOT] = BRACKET_PENDING;
+    for (int side = 0; side < 2; side++) {
+        zone->arena.fighters[side].state = pack_state(1, 1 - side, BENCH_SLOT, 0);
+        zone->arena.bracket[2 * BENCH_SLOT + side] = side;
+    }
+    sem_init(&zone->turns[0], 1, 0);
+    sem_init(&zone->turns[1], 1, 0);
+    fflush(stdout);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int side = 0; side < 2; side++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (mode == 2) {
+                play_semaphores(side, rounds);
+            } else {
+                play_mailbox(side, rounds, mode == 0 ? MAILBOX_SPINS : 0);
+            }
+            exit(0);
+        } else if (pid < 0) {
+            perror("Проблема с созданием процесса.");
+            exit(1);
+        }
+    }
+    wait(NULL);
+    wait(NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sem_destroy(&zone->turns[0]);
+    sem_destroy(&zone->turns[1]);
+
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return elapsed_ns / rounds / 1000.0;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    if (rounds < 1) {
+        printf("Использовано %s [раунды].\n", argv[0]);
+        return 1;
+    }
+
+    zone = mmap(NULL, sizeof(BenchZone), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (zone == MAP_FAILED) {
+        perror("Проблема с отображением памяти.");
+        return 1;
+    }
+    combat_zone = &zone->arena;
+
+    printf("Раундов боя: %d, процессоров: %ld.\n", rounds, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("почтовый ящик, спин + futex: %.2f мкс/раунд\n", run_bench(0, rounds));
+    printf("почтовый ящик, только futex: %.2f мкс/раунд\n", run_bench(1, rounds));
+    printf("пара семафоров:              %.2f мкс/раунд\n", run_bench(2, rounds));
+
+    munmap(zone, sizeof(BenchZone));
+    return 0;
+}
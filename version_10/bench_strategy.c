@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gesture.h"
+#include "strategy.h"
+
+#define DEFAULT_DECISIONS 2000000
+#define RIVAL_REPEAT_PERCENT 70
+#define RIVAL_SWITCHES 10000
+
+MoveHistory rival_history[2];
+Strategy strategy;
+HandSign *rival_moves;
+
+double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+void prepare_rival(int decisions) {
+    HandSign move = 0;
+    for (int i = 0; i < decisions; i++) {
+        if (rand() % 100 < RIVAL_REPEAT_PERCENT) {
+            move = (move + 1) % gesture_count();
+        } else {
+            move = rand() % gesture_count();
+        }
+        rival_moves[i] = move;
+    }
+}
+
+int prepare_strategy(int kind, const char *plugin_path) {
+    strategy_unload(&strategy);
+    strategy_init(&strategy, kind);
+    return plugin_path == NULL || strategy_load(&strategy, plugin_path);
+}
+
+void run_bench(int kind, const char *plugin_path, int decisions) {
+    int wins = 0;
+    int losses = 0;
+    memset(rival_history, 0, sizeof(rival_history));
+    if (!prepare_strategy(kind, plugin_path)) {
+        return;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < decisions; i++) {
+        strategy_observe(&strategy, 0, &rival_history[0]);
+        HandSign move = strategy_choose(&strategy);
+        int outcome = gesture_outcome(move, rival_moves[i]);
+        wins += outcome == 1;
+        losses += outcome == 2;
+        history_record(&rival_history[0], rival_moves[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = elapsed_ns(&start, &end) / decisions;
+    printf("  %-10s %8.1f нс/ход  %10.0f ходов/с  побед %5.1f%%, поражений %5.1f%%\n",
+           strategy_name(&strategy), ns, 1e9 / ns, 100.0 * wins / decisions, 100.0 * losses / decisions);
+}
+
+void run_switch_bench(int kind, const char *plugin_path) {
+    if (!prepare_strategy(kind, plugin_path)) {
+        return;
+    }
+    for (int i = 0; i < HISTORY_SIZE; i++) {
+        history_record(&rival_history[0], rival_moves[i]);
+        history_record(&rival_history[1], rival_moves[i + HISTORY_SIZE]);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < RIVAL_SWITCHES; i++) {
+        strategy_observe(&strategy, i & 1, &rival_history[i & 1]);
+        strategy_choose(&strategy);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("  %-10s смена соперника: %.0f нс\n", strategy_name(&strategy), elapsed_ns(&start, &end) / RIVAL_SWITCHES);
+}
+
+int main(int argc, char *argv[]) {
+    int decisions = argc > 1 ? atoi(argv[1]) : DEFAULT_DECISIONS;
+    if (decisions < 2 * HISTORY_SIZE) {
+        printf("Использовано %s [ходы] [модуль.so...].\n", argv[0]);
+        return 1;
+    }
+
+    rival_moves = malloc(decisions * sizeof(HandSign));
+    if (rival_moves == NULL) {
+        perror("Проблема с выделением памяти.");
+        return 1;
+    }
+    srand(1);
+
+    const char *sets[] = {"rps", "rpsls", "rps101"};
+    for (int set = 0; set < 3; set++) {
+        gesture_init(gesture_count_for(sets[set]));
+        prepare_rival(decisions);
+        printf("Набор %s, жестов: %d, ходов: %d.\n", sets[set], gesture_count(), decisions);
+        for (int kind = 0; kind < STRATEGY_PLUGIN; kind++) {
+            run_bench(kind, NULL, decisions);
+        }
+        for (int plugin = 2; plugin < argc; plugin++) {
+            run_bench(STRATEGY_PLUGIN, argv[plugin], decisions);
+        }
+        for (int kind = STRATEGY_FREQUENCY; kind < STRATEGY_PLUGIN; kind++) {
+            run_switch_bench(kind, NULL);
+        }
+        for (int plugin = 2; plugin < argc; plugin++) {
+            run_switch_bench(STRATEGY_PLUGIN, argv[plugin]);
+        }
+    }
+
+    strategy_unload(&strategy);
+    free(rival_moves);
+    return 0;
+}
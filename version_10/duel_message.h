@@ -0,0 +1,24 @@
+#ifndef DUEL_MESSAGE_H
+#define DUEL_MESSAGE_H
+
+#include "gesture.h"
+
+#define MSG_SIZE 256
+#define OBSERVER_PATH_BASE "/tmp/battle_observer_10"
+#define MAX_OBSERVERS 10
+
+typedef struct {
+    char text[MSG_SIZE];
+    int from_id;
+    int against_id;
+    int round_count;
+    int is_result;
+    HandSign move1;
+    HandSign move2;
+    int duel_rounds;
+    int gesture_count;
+    unsigned int event_seq;
+    int kind;
+} DuelMessage;
+
+#endif
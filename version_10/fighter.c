@@ -3,330 +3,451 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include <semaphore.h>
 #include <signal.h>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
 #include <fcntl.h>
-
-#define MAX_FIGHTERS 32
-#define MSG_SIZE 256
-#define OBSERVER_PATH_BASE "/tmp/battle_observer"
-#define MAX_OBSERVERS 10
-#define SHM_NAME "/battle_arena_10"
-#define SEM_NAME "/battle_sem_10"
-
-typedef enum {
-    ROCK = 0,
-    SCISSORS = 1,
-    PAPER = 2
-} HandSign;
-
-typedef struct {
-    int id;
-    int active;
-    int victories;
-    HandSign gesture;
-    int has_rival;
-    int rival_id;
-    int connected;
-} Combatant;
-
-typedef struct {
-    Combatant fighters[MAX_FIGHTERS];
-    int total_count;
-    int alive_count;
-    int round_num;
-    int finished;
-    int terminated;
-} Arena;
-
-typedef struct {
-    char text[MSG_SIZE];
-    int from_id;
-    int against_id;
-    int round_count;
-    int is_result;
-    HandSign move1;
-    HandSign move2;
-    int duel_rounds;
-} DuelMessage;
-
-Arena *combat_zone;
+#include <poll.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+
+#include "gesture.h"
+#include "strategy.h"
+#include "arena.h"
+#include "watch_filter.h"
+#include "duel_message.h"
+#include "wait_entry.h"
+#include "stats.h"
+
+#define RESULT_SEM_NAME "/battle_done_10"
+#define READY_SEM_NAME "/battle_ready_10"
+#define READY_MARK_PATH "/tmp/battle_ready_10"
+#define ZONE_WAIT_SEC 30
+#define HEARTBEAT_STALL_CHECKS 30
+#define COORDINATOR_GRACE_CHECKS 20
+
+size_t zone_size = sizeof(Arena);
 int zone_fd;
-sem_t *combat_sem;
-
-void sem_lock(sem_t *sem) {
-    int result;
-    do {
-        result = sem_wait(sem);
-    } while (result == -1 && errno == EINTR);
-}
-
-void sem_unlock(sem_t *sem) {
-    int result;
-    do {
-        result = sem_post(sem);
-    } while (result == -1 && errno == EINTR);
-}
-
-void send_to_watchers(const char* message, int from_id, int against_id,
+sem_t *result_sem;
+sem_t *ready_sem;
+int coordinator_fd = -1;
+pid_t coordinator_pid;
+int orphan_checks;
+unsigned int zone_generation;
+unsigned int last_heartbeat;
+int heartbeat_stalls;
+Strategy strategy;
+WatchFilter *watch_filters;
+TournamentStats *stats;
+unsigned int recorded_turn;
+int refreshed_slot = -1;
+
+void send_to_watchers(EventKind kind, const char* message, int from_id, int against_id, int round_count,
                       int is_result, HandSign move1, HandSign move2, int duel_rounds) {
     DuelMessage msg;
     strncpy(msg.text, message, MSG_SIZE-1);
     msg.text[MSG_SIZE-1] = '\0';
     msg.from_id = from_id;
     msg.against_id = against_id;
-    msg.round_count = combat_zone->round_num;
+    msg.round_count = round_count;
     msg.is_result = is_result;
     msg.move1 = move1;
     msg.move2 = move2;
     msg.duel_rounds = duel_rounds;
+    msg.gesture_count = combat_zone->gesture_count;
+    msg.kind = kind;
+
+    if (watch_filters == NULL) {
+        watch_filters = open_watch_filters(MAX_OBSERVERS, 0);
+    }
 
     for (int i = 0; i < MAX_OBSERVERS; i++) {
+        WatchFilter *filter = watch_filters ? &watch_filters[i] : NULL;
+        if (!watcher_wants(filter, kind, from_id, against_id)) {
+            continue;
+        }
         char pipe_path[64];
         snprintf(pipe_path, sizeof(pipe_path), "%s_%d", OBSERVER_PATH_BASE, i);
         int pipe_fd = open(pipe_path, O_WRONLY | O_NONBLOCK);
         if (pipe_fd != -1) {
-            ssize_t bytes_written = write(pipe_fd, &msg, sizeof(DuelMessage));
-            (void)bytes_written;
+            msg.event_seq = watcher_next_seq(filter);
+            deliver_to_watcher(filter, pipe_fd, pipe_path, &msg, sizeof(DuelMessage), 0);
             close(pipe_fd);
         }
     }
 }
 
+void wake_coordinator() {
+    sem_post(result_sem);
+}
+
 void fighter_cleanup() {
     if (combat_zone) {
-        munmap(combat_zone, sizeof(Arena));
+        munmap(combat_zone, zone_size);
     }
     if (zone_fd != -1) {
         close(zone_fd);
     }
-    if (combat_sem != SEM_FAILED) {
-        sem_close(combat_sem);
+    if (result_sem != SEM_FAILED) {
+        sem_close(result_sem);
+    }
+    if (ready_sem != SEM_FAILED) {
+        sem_close(ready_sem);
     }
+    if (coordinator_fd != -1) {
+        close(coordinator_fd);
+    }
+    close_watch_filters(watch_filters, MAX_OBSERVERS);
+    close_stats(stats);
 }
 
 void signal_handler(int sig) {
     printf("Боец остановлен по сигналу %d.\n", sig);
-    fighter_cleanup();
+    if (!holding_arena) {
+        fighter_cleanup();
+    }
     exit(0);
 }
 
-HandSign get_winner(HandSign sign1, HandSign sign2) {
-    if (sign1 == sign2) return (HandSign)-1;
+int open_coordinator(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+int coordinator_alive() {
+    if (coordinator_fd != -1) {
+        struct pollfd exit_poll = {coordinator_fd, POLLIN, 0};
+        return poll(&exit_poll, 1, 0) == 0;
+    }
+    return kill(combat_zone->coordinator_pid, 0) == 0 || errno == EPERM;
+}
+
+int zone_alive() {
+    if (__atomic_load_n(&combat_zone->generation, __ATOMIC_ACQUIRE) != zone_generation) {
+        return 0;
+    }
+
+    unsigned int heartbeat = __atomic_load_n(&combat_zone->heartbeat, __ATOMIC_ACQUIRE);
+    if (heartbeat != last_heartbeat) {
+        last_heartbeat = heartbeat;
+        heartbeat_stalls = 0;
+        return 1;
+    }
+
+    if (++heartbeat_stalls < HEARTBEAT_STALL_CHECKS) {
+        return 1;
+    }
+    heartbeat_stalls = 0;
+
+    pid_t pid = __atomic_load_n(&combat_zone->coordinator_pid, __ATOMIC_ACQUIRE);
+    if (pid != coordinator_pid) {
+        if (coordinator_fd != -1) {
+            close(coordinator_fd);
+        }
+        coordinator_pid = pid;
+        coordinator_fd = open_coordinator(pid);
+        orphan_checks = 0;
+    }
+
+    if (coordinator_alive()) {
+        orphan_checks = 0;
+        return 1;
+    }
+    if (orphan_checks++ == 0) {
+        printf("Координатор не отвечает, ожидание перезапуска турнира.\n");
+    }
+    return orphan_checks < COORDINATOR_GRACE_CHECKS;
+}
+
+void refresh_strategy(int fighter_id) {
+    int reloaded = strategy_reload(&strategy);
+    if (reloaded > 0) {
+        printf("Боец %d перезагрузил стратегию %s.\n", fighter_id, strategy_name(&strategy));
+    } else if (reloaded < 0) {
+        printf("Боец %d играет случайно до исправления модуля стратегии.\n", fighter_id);
+    }
+}
+
+void submit_gesture(int fighter_id, int rival_id, unsigned int turn) {
+    Combatant *self = &combat_zone->fighters[fighter_id];
+    strategy_observe(&strategy, rival_id, &combat_zone->histories[rival_id]);
+    self->submitted = strategy_choose(&strategy);
+    __atomic_store_n(&self->submitted_turn, turn, __ATOMIC_RELEASE);
+
+    unsigned long long state = __atomic_load_n(&combat_zone->referee_pending, __ATOMIC_ACQUIRE);
+    while ((unsigned int)(state >> 32) == turn && (state & 0xffffffffULL) > 0) {
+        if (__atomic_compare_exchange_n(&combat_zone->referee_pending, &state, state - 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if (((state - 1) & 0xffffffffULL) == 0) {
+                sem_post(result_sem);
+            }
+            break;
+        }
+    }
+}
+
+int play_referee_turn(int fighter_id) {
+    unsigned int turn = __atomic_load_n(&combat_zone->referee_turn, __ATOMIC_ACQUIRE);
+    Combatant *self = &combat_zone->fighters[fighter_id];
+
+    if (__atomic_load_n(&combat_zone->finished, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&combat_zone->terminated, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    unsigned long long state = load_state(fighter_id);
+    if (!state_active(state)) {
+        send_to_watchers(EVENT_FIGHTER, "Боец выбыл из турнира.", fighter_id, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
+        return 0;
+    }
+
+    if (state_rival(state) >= 0 && state_slot(state) != refreshed_slot) {
+        refresh_strategy(fighter_id);
+        refreshed_slot = state_slot(state);
+    }
+
+    unsigned int submitted_turn = __atomic_load_n(&self->submitted_turn, __ATOMIC_RELAXED);
+    if (submitted_turn != recorded_turn && submitted_turn != turn) {
+        history_record(&combat_zone->histories[fighter_id], self->submitted);
+        recorded_turn = submitted_turn;
+    }
 
-    if ((sign1 == ROCK && sign2 == SCISSORS) ||
-        (sign1 == SCISSORS && sign2 == PAPER) ||
-        (sign1 == PAPER && sign2 == ROCK)) {
-        return sign1;
+    if (state_rival(state) >= 0 && submitted_turn != turn) {
+        submit_gesture(fighter_id, state_rival(state), turn);
     }
-    return sign2;
+
+    struct timespec timeout = {0, 100000000};
+    futex(&combat_zone->referee_turn, FUTEX_WAIT, turn, &timeout);
+    return 1;
 }
 
-const char* gesture_name(HandSign sign) {
-    switch(sign) {
-        case ROCK: return "Камень";
-        case SCISSORS: return "Ножницы";
-        case PAPER: return "Бумага";
-        default: return "Неизвестно";
+void play_duel(int fighter_id, int rival_id, int slot) {
+    DuelMailbox *box = &combat_zone->mailboxes[slot];
+    int side = combat_zone->bracket[2 * slot] == fighter_id ? 0 : 1;
+    int fighter1 = side == 0 ? fighter_id : rival_id;
+    int fighter2 = side == 0 ? rival_id : fighter_id;
+    int duel_round = slot_round(slot);
+    unsigned int exchange = 1;
+    HandSign moves[2];
+    HandSign winner_move;
+
+    do {
+        strategy_observe(&strategy, rival_id, &combat_zone->histories[rival_id]);
+        moves[side] = strategy_choose(&strategy);
+        combat_zone->fighters[fighter_id].gesture = moves[side];
+        publish_move(box, side, exchange, moves[side]);
+
+        int reply = await_rival(box, side, exchange, MAILBOX_SPINS, fighter_id, slot);
+        if (reply == 0) {
+            return;
+        }
+        if (reply < 0) {
+            printf("Боец %d не отвечает в бою с Бойцом %d.\n", rival_id, fighter_id);
+            begin_commit();
+            __atomic_store_n(&combat_zone->fighters[rival_id].connected, 0, __ATOMIC_RELEASE);
+            end_commit();
+            sem_post(result_sem);
+            return;
+        }
+
+        moves[1 - side] = __atomic_load_n(&box->moves[1 - side][exchange & 1], __ATOMIC_ACQUIRE) & MAILBOX_MOVE_MASK;
+        history_record(&combat_zone->histories[fighter_id], moves[side]);
+        winner_move = get_winner(moves[0], moves[1]);
+        stats_exchange(stats, fighter_id, moves[side], winner_move == (HandSign)-1);
+        if (side == 0) {
+            stats_round_exchange(stats, duel_round, winner_move == (HandSign)-1);
+        }
+
+        if (side == 0 && exchange == 1) {
+            char message[MSG_SIZE];
+            snprintf(message, MSG_SIZE, "Начало боя между Бойцом %d и Бойцом %d.", fighter1, fighter2);
+            send_to_watchers(EVENT_DUEL_START, message, fighter1, fighter2, duel_round, 0, moves[0], moves[1], 0);
+        }
+        if (side == 0 && winner_move == (HandSign)-1) {
+            char message[MSG_SIZE];
+            snprintf(message, MSG_SIZE, "Ничья в бою %d vs %d (раунд %d).", fighter1, fighter2, exchange);
+            send_to_watchers(EVENT_DRAW, message, fighter1, fighter2, duel_round, 0, moves[0], moves[1], exchange);
+        }
+        exchange++;
+    } while (winner_move == (HandSign)-1);
+
+    int winner = winner_move == moves[0] ? fighter1 : fighter2;
+    int loser = winner == fighter1 ? fighter2 : fighter1;
+    if (!commit_outcome(slot, winner, loser)) {
+        return;
     }
+
+    int duel_rounds = exchange - 1;
+    stats_duel(stats, duel_round, winner, loser, duel_rounds);
+    char message[MSG_SIZE];
+    snprintf(message, MSG_SIZE, "Боец %d победил Бойца %d за %d раундов.", winner, loser, duel_rounds);
+    send_to_watchers(EVENT_RESULT, message, fighter1, fighter2, duel_round, 1, moves[0], moves[1], duel_rounds);
+    sem_post(result_sem);
 }
 
-int check_zone_exists() {
-    int fd = shm_open("/battle_arena_10", O_RDONLY, 0666);
-    if (fd == -1) {
+int wait_next_poll(int fighter_id) {
+    struct timespec delay = {0, 100000000};
+    int sleep_result;
+    do {
+        sleep_result = nanosleep(&delay, &delay);
+    } while (sleep_result == -1 && errno == EINTR);
+
+    if (!zone_alive()) {
+        printf("На бойце %d арена уничтожена.\n", fighter_id);
         return 0;
     }
-    close(fd);
     return 1;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Использовано %s <ID_бойца>.\n", argv[0]);
+    if (argc < 2 || argc > 4) {
+        printf("Использовано %s <ID_бойца> [random|frequency|markov|mixed|модуль.so] [имя].\n", argv[0]);
         return 1;
     }
 
+    int strategy_kind = argc >= 3 ? strategy_kind_for(argv[2]) : STRATEGY_RANDOM;
+    const char *plugin_path = NULL;
+    if (strategy_kind < 0) {
+        if (strchr(argv[2], '/') == NULL && strstr(argv[2], ".so") == NULL) {
+            printf("Неизвестная стратегия: %s.\n", argv[2]);
+            return 1;
+        }
+        strategy_kind = STRATEGY_PLUGIN;
+        plugin_path = argv[2];
+    }
+    strategy_init(&strategy, strategy_kind);
+
     int fighter_id = atoi(argv[1]);
     if (fighter_id < 0 || fighter_id >= MAX_FIGHTERS) {
         printf("Неверный ID бойца. Должен быть от 0 до %d\n", MAX_FIGHTERS-1);
         return 1;
     }
+    arena_set_owner(fighter_id, wake_coordinator);
 
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     srand(time(NULL) + fighter_id + getpid());
 
-    int wait_attempts = 30;
-    while (wait_attempts > 0) {
-        if (check_zone_exists()) {
-            break;
-        }
-        sleep(1);
-        wait_attempts--;
-    }
-
-    if (!check_zone_exists()) {
+    if (!wait_for_entry(READY_MARK_PATH, ZONE_WAIT_SEC)) {
         printf("Для бойца %d арена не создана.\n", fighter_id);
         return 1;
     }
 
-    zone_fd = shm_open("/battle_arena_10", O_RDWR, 0666);
+    zone_fd = open(HUGE_ZONE_PATH, O_RDWR);
     if (zone_fd == -1) {
+        zone_fd = shm_open(SHM_NAME, O_RDWR, 0666);
+    }
+    struct stat zone_info;
+    if (zone_fd == -1 || fstat(zone_fd, &zone_info) == -1 || zone_info.st_size < (off_t)sizeof(Arena)) {
         printf("У бойца %d проблема с подключением к арене.\n", fighter_id);
         return 1;
     }
 
-    combat_zone = mmap(NULL, sizeof(Arena), PROT_READ | PROT_WRITE, MAP_SHARED, zone_fd, 0);
+    zone_size = zone_info.st_size;
+    combat_zone = mmap(NULL, zone_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, zone_fd, 0);
     if (combat_zone == MAP_FAILED) {
         printf("У бойца %d проблема с отображением памяти.\n", fighter_id);
         close(zone_fd);
         return 1;
     }
+    if (combat_zone->map_options & ZONE_MAP_THP) {
+        madvise(combat_zone, zone_size, MADV_HUGEPAGE);
+    }
+    if ((combat_zone->map_options & ZONE_MAP_LOCK) && mlock(combat_zone, zone_size) == -1) {
+        printf("Боец %d не смог закрепить арену в памяти.\n", fighter_id);
+    }
 
-    combat_sem = sem_open(SEM_NAME, 0);
-    if (combat_sem == SEM_FAILED) {
-        printf("У бойца %d проблема с подключением к семафору битвы.\n", fighter_id);
+    if (!gesture_init(combat_zone->gesture_count)) {
+        printf("У бойца %d неизвестный набор жестов.\n", fighter_id);
         fighter_cleanup();
         return 1;
     }
+    if (plugin_path && !strategy_load(&strategy, plugin_path)) {
+        fighter_cleanup();
+        return 1;
+    }
+    stats = open_stats(0, 0);
 
-    int id_check_attempts = 30;
-    while (id_check_attempts > 0) {
-        sem_lock(combat_sem);
-        if (combat_zone->total_count > 0 && fighter_id < combat_zone->total_count) {
-            sem_unlock(combat_sem);
-            break;
-        }
-        sem_unlock(combat_sem);
-        sleep(1);
-        id_check_attempts--;
+    result_sem = sem_open(RESULT_SEM_NAME, 0);
+    if (result_sem == SEM_FAILED) {
+        printf("У бойца %d проблема с подключением к семафору результатов.\n", fighter_id);
+        fighter_cleanup();
+        return 1;
     }
 
-    sem_lock(combat_sem);
+    ready_sem = sem_open(READY_SEM_NAME, 0);
+    if (ready_sem == SEM_FAILED) {
+        printf("У бойца %d проблема с подключением к семафору готовности.\n", fighter_id);
+        fighter_cleanup();
+        return 1;
+    }
+
+    arena_lock();
     if (fighter_id >= combat_zone->total_count || combat_zone->total_count == 0) {
         printf("У бойца %d недопустимый ID или турнир не готов.\n", fighter_id);
-        sem_unlock(combat_sem);
+        arena_unlock();
         fighter_cleanup();
         return 1;
     }
 
     combat_zone->fighters[fighter_id].connected = 1;
-    sem_unlock(combat_sem);
+    if (argc == 4) {
+        snprintf(combat_zone->names[fighter_id], FIGHTER_NAME_SIZE, "%s", argv[3]);
+    }
+    zone_generation = combat_zone->generation;
+    last_heartbeat = combat_zone->heartbeat;
+    coordinator_pid = combat_zone->coordinator_pid;
+    coordinator_fd = open_coordinator(coordinator_pid);
+    arena_unlock();
+    sem_post(ready_sem);
 
-    printf("Боец %d начал участие в турнире.\n", fighter_id);
-    send_to_watchers("Боец присоединился к турниру.", fighter_id, -1, 0, ROCK, ROCK, 0);
+    printf("Боец %d начал участие в турнире, стратегия %s.\n", fighter_id, strategy_name(&strategy));
+    send_to_watchers(EVENT_FIGHTER, "Боец присоединился к турниру.", fighter_id, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
 
     while (1) {
-        sem_lock(combat_sem);
+        if (combat_zone->referee) {
+            if (!play_referee_turn(fighter_id)) {
+                break;
+            }
+            if (!zone_alive()) {
+                printf("На бойце %d арена уничтожена.\n", fighter_id);
+                break;
+            }
+            continue;
+        }
 
-        if (combat_zone->finished || combat_zone->terminated) {
-            sem_unlock(combat_sem);
+        if (__atomic_load_n(&combat_zone->finished, __ATOMIC_ACQUIRE) ||
+            __atomic_load_n(&combat_zone->terminated, __ATOMIC_ACQUIRE)) {
             break;
         }
 
-        if (!combat_zone->fighters[fighter_id].active) {
-            sem_unlock(combat_sem);
-            send_to_watchers("Боец выбыл из турнира.", fighter_id, -1, 0, ROCK, ROCK, 0);
+        unsigned long long state = load_state(fighter_id);
+        if (!state_active(state)) {
+            send_to_watchers(EVENT_FIGHTER, "Боец выбыл из турнира.", fighter_id, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
             break;
         }
 
-        if (combat_zone->fighters[fighter_id].has_rival) {
-            int rival_id = combat_zone->fighters[fighter_id].rival_id;
-
-            if (rival_id < 0 || rival_id >= combat_zone->total_count ||
-                !combat_zone->fighters[rival_id].active) {
-                combat_zone->fighters[fighter_id].has_rival = 0;
-                combat_zone->fighters[fighter_id].rival_id = -1;
-                sem_unlock(combat_sem);
-                continue;
-            }
-
-            HandSign my_move;
-            HandSign rival_move;
-            HandSign winner_move;
-            int duel_rounds = 0;
-
-            do {
-                duel_rounds++;
-                my_move = rand() % 3;
-                rival_move = rand() % 3;
-                winner_move = get_winner(my_move, rival_move);
-
-                combat_zone->fighters[fighter_id].gesture = my_move;
-                combat_zone->fighters[rival_id].gesture = rival_move;
-
-                if (duel_rounds == 1) {
-                    char message[MSG_SIZE];
-                    snprintf(message, MSG_SIZE, "Начало боя между Бойцом %d и Бойцом %d.", fighter_id, rival_id);
-                    send_to_watchers(message, fighter_id, rival_id, 0, my_move, rival_move, 0);
-                }
-
-                if (winner_move == (HandSign)-1) {
-                    char message[MSG_SIZE];
-                    snprintf(message, MSG_SIZE, "Ничья в бою %d vs %d (раунд %d).", fighter_id, rival_id, duel_rounds);
-                    send_to_watchers(message, fighter_id, rival_id, 0, my_move, rival_move, duel_rounds);
-
-                    struct timespec delay = {0, 100000000};
-                    int sleep_result;
-                    do {
-                        sleep_result = nanosleep(&delay, &delay);
-                    } while (sleep_result == -1 && errno == EINTR);
-
-                    if (combat_zone->finished || combat_zone->terminated ||
-                        !combat_zone->fighters[fighter_id].active ||
-                        !combat_zone->fighters[rival_id].active) {
-                        break;
-                    }
-                }
-            } while (winner_move == (HandSign)-1);
-
-            if (combat_zone->finished || combat_zone->terminated ||
-                !combat_zone->fighters[fighter_id].active) {
-                sem_unlock(combat_sem);
-                break;
-            }
-
-            if (winner_move != (HandSign)-1) {
-                char message[MSG_SIZE];
-                if (winner_move == my_move) {
-                    snprintf(message, MSG_SIZE, "Боец %d победил Бойца %d за %d раундов.", fighter_id, rival_id, duel_rounds);
-                    combat_zone->fighters[fighter_id].victories++;
-                    combat_zone->fighters[rival_id].active = 0;
-                    combat_zone->alive_count--;
-                } else {
-                    snprintf(message, MSG_SIZE, "Боец %d победил Бойца %d за %d раундов.", rival_id, fighter_id, duel_rounds);
-                    combat_zone->fighters[rival_id].victories++;
-                    combat_zone->fighters[fighter_id].active = 0;
-                    combat_zone->alive_count--;
-                }
-
-                send_to_watchers(message, fighter_id, rival_id, 1, my_move, rival_move, duel_rounds);
-            }
-
-            combat_zone->fighters[fighter_id].has_rival = 0;
-            combat_zone->fighters[fighter_id].rival_id = -1;
-            combat_zone->fighters[rival_id].has_rival = 0;
-            combat_zone->fighters[rival_id].rival_id = -1;
+        int rival_id = state_rival(state);
+        if (rival_id >= 0 && rival_id < combat_zone->total_count &&
+            combat_zone->fighters[rival_id].connected) {
+            refresh_strategy(fighter_id);
+            play_duel(fighter_id, rival_id, state_slot(state));
         }
 
-        sem_unlock(combat_sem);
-
-        struct timespec delay = {0, 100000000};
-        int sleep_result;
-        do {
-            sleep_result = nanosleep(&delay, &delay);
-        } while (sleep_result == -1 && errno == EINTR);
-
-        if (!check_zone_exists()) {
-            printf("На бойце %d арена уничтожена.\n", fighter_id);
+        if (!wait_next_poll(fighter_id)) {
             break;
         }
     }
 
     printf("Боец %d завершил участие.\n", fighter_id);
+    strategy_unload(&strategy);
     fighter_cleanup();
     return 0;
 }
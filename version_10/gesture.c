@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gesture.h"
+
+typedef struct {
+    const char *set_name;
+    int count;
+    const char *names[5];
+} GestureSet;
+
+const GestureSet named_sets[] = {
+    {"rps", 3, {"Камень", "Ножницы", "Бумага"}},
+    {"rpsls", 5, {"Камень", "Ножницы", "Ящерица", "Бумага", "Спок"}},
+    {"rps101", 101, {NULL}}
+};
+
+#define NAMED_SETS (int)(sizeof(named_sets) / sizeof(named_sets[0]))
+
+unsigned long long beats_table[MAX_GESTURES][GESTURE_WORDS];
+char generated_names[MAX_GESTURES][24];
+const char *names_table[MAX_GESTURES];
+int active_count;
+
+int gesture_count_for(const char *set_name) {
+    for (int i = 0; i < NAMED_SETS; i++) {
+        if (strcmp(named_sets[i].set_name, set_name) == 0) {
+            return named_sets[i].count;
+        }
+    }
+
+    char *end;
+    long count = strtol(set_name, &end, 10);
+    if (*end != '\0' || count < 3 || count > MAX_GESTURES || count % 2 == 0) {
+        return 0;
+    }
+    return (int)count;
+}
+
+int gesture_init(int count) {
+    if (count < 3 || count > MAX_GESTURES || count % 2 == 0) {
+        return 0;
+    }
+    if (count == active_count) {
+        return 1;
+    }
+
+    const GestureSet *named = NULL;
+    for (int i = 0; i < NAMED_SETS; i++) {
+        if (named_sets[i].count == count) {
+            named = &named_sets[i];
+        }
+    }
+
+    memset(beats_table, 0, sizeof(beats_table));
+    for (int sign = 0; sign < count; sign++) {
+        for (int step = 1; step <= (count - 1) / 2; step++) {
+            int beaten = (sign + step) % count;
+            beats_table[sign][beaten >> 6] |= 1ULL << (beaten & 63);
+        }
+
+        if (named && sign < 5 && named->names[sign]) {
+            names_table[sign] = named->names[sign];
+        } else {
+            snprintf(generated_names[sign], sizeof(generated_names[sign]), "Жест %d", sign);
+            names_table[sign] = generated_names[sign];
+        }
+    }
+
+    active_count = count;
+    return 1;
+}
+
+int gesture_count() {
+    return active_count;
+}
+
+int gesture_beats(HandSign sign1, HandSign sign2) {
+    return (int)(beats_table[sign1][sign2 >> 6] >> (sign2 & 63)) & 1;
+}
+
+int gesture_outcome(HandSign sign1, HandSign sign2) {
+    return gesture_beats(sign1, sign2) | gesture_beats(sign2, sign1) << 1;
+}
+
+HandSign get_winner(HandSign sign1, HandSign sign2) {
+    int first = gesture_beats(sign1, sign2);
+    int second = gesture_beats(sign2, sign1);
+    return first * sign1 + second * sign2 - !(first | second);
+}
+
+HandSign gesture_counter(HandSign sign) {
+    return (sign + active_count - 1) % active_count;
+}
+
+const char *gesture_name(HandSign sign) {
+    if (sign < 0 || sign >= active_count) {
+        return "Неизвестно";
+    }
+    return names_table[sign];
+}
@@ -1,50 +1,39 @@
 #include <time.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
 #include <semaphore.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+#include "gesture.h"
+#include "watch_filter.h"
+#include "duel_message.h"
+#include "wait_entry.h"
+
 #define MAX_FIGHTERS 32
-#define MSG_SIZE 256
-#define OBSERVER_PATH_BASE "/tmp/battle_observer_10"
-#define MAX_OBSERVERS 10
 #define SHM_NAME "/battle_arena_10"
-
-typedef enum {
-    ROCK = 0,
-    SCISSORS = 1,
-    PAPER = 2
-} HandSign;
-
-typedef struct {
-    char text[MSG_SIZE];
-    int from_id;
-    int against_id;
-    int round_count;
-    int is_result;
-    HandSign move1;
-    HandSign move2;
-    int duel_rounds;
-} DuelMessage;
+#define READY_SEM_NAME "/battle_ready_10"
+#define TOURNAMENT_WAIT_SEC 300
 
 int observer_pipe = -1;
 char observer_pipe_path[64];
 int observer_id;
-
-const char* gesture_name(HandSign sign) {
-    switch(sign) {
-        case ROCK: return "Камень";
-        case SCISSORS: return "Ножницы";
-        case PAPER: return "Бумага";
-        default: return "Неизвестно";
-    }
-}
+WatchFilter *watch_filters;
+char relay_socket[108];
+int relay_fd = -1;
+DuelMessage relay_buffer;
+size_t relay_filled;
+WatchFilter watch_filter = {.kinds = EVENT_ALL, .draw_sample = 1, .policy = WATCH_DROP_NEWEST,
+                            .block_ms = WATCH_BLOCK_DEFAULT_MS};
 
 int create_watch_channel(int watch_id) {
     char pipe_path[64];
@@ -54,12 +43,63 @@ int create_watch_channel(int watch_id) {
     return 0;
 }
 
+void announce_ready() {
+    sem_t *ready_sem = sem_open(READY_SEM_NAME, 0);
+    if (ready_sem != SEM_FAILED) {
+        sem_post(ready_sem);
+        sem_close(ready_sem);
+    }
+}
+
+int connect_relay() {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", relay_socket);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int get_relay_update(DuelMessage *msg) {
+    while (relay_fd != -1) {
+        ssize_t length = recv(relay_fd, (char *)&relay_buffer + relay_filled,
+                              sizeof(DuelMessage) - relay_filled, MSG_DONTWAIT);
+        if (length == -1 && errno == EINTR) {
+            continue;
+        }
+        if (length == 0) {
+            close(relay_fd);
+            relay_fd = -1;
+        }
+        if (length <= 0) {
+            return 0;
+        }
+
+        relay_filled += length;
+        if (relay_filled == sizeof(DuelMessage)) {
+            *msg = relay_buffer;
+            relay_filled = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int get_duel_update(DuelMessage *msg) {
+    if (relay_socket[0]) {
+        return get_relay_update(msg);
+    }
     if (observer_pipe == -1) {
         observer_pipe = open(observer_pipe_path, O_RDONLY | O_NONBLOCK);
         if (observer_pipe == -1) {
             return 0;
         }
+        announce_ready();
     }
     int bytes_read = read(observer_pipe, msg, sizeof(DuelMessage));
     if (bytes_read == sizeof(DuelMessage)) {
@@ -77,11 +117,70 @@ int check_tournament_finished() {
     return 0;
 }
 
+unsigned int fighter_set_for(const char *list) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%s", list);
+
+    unsigned int fighters = 0;
+    char *saved;
+    for (char *item = strtok_r(buffer, ",", &saved); item; item = strtok_r(NULL, ",", &saved)) {
+        char *end;
+        long fighter = strtol(item, &end, 10);
+        if (*end != '\0' || fighter < 0 || fighter >= MAX_FIGHTERS) {
+            return 0;
+        }
+        fighters |= 1U << fighter;
+    }
+    return fighters;
+}
+
+void register_filter() {
+    watch_filters = open_watch_filters(MAX_OBSERVERS, 0);
+    if (watch_filters == NULL) {
+        printf("Фильтр недоступен, будут показаны все события.\n");
+        return;
+    }
+
+    WatchFilter *slot = &watch_filters[observer_id];
+    slot->kinds = watch_filter.kinds;
+    slot->fighters = watch_filter.fighters;
+    slot->draw_sample = watch_filter.draw_sample;
+    slot->draw_counter = 0;
+    slot->policy = watch_filter.policy;
+    slot->block_ms = watch_filter.block_ms;
+    slot->published = 0;
+    slot->queued = 0;
+    slot->dropped = 0;
+    slot->lag = 0;
+    slot->max_lag = 0;
+    slot->stalled = 0;
+    __atomic_store_n(&slot->active, 1, __ATOMIC_RELEASE);
+}
+
+void report_losses() {
+    if (watch_filters == NULL) {
+        return;
+    }
+    WatchFilter *slot = &watch_filters[observer_id];
+    printf("Политика %s: записано %u, потеряно %u, макс. отставание %u.\n",
+           watch_policy_name(slot->policy), __atomic_load_n(&slot->queued, __ATOMIC_RELAXED),
+           __atomic_load_n(&slot->dropped, __ATOMIC_RELAXED), __atomic_load_n(&slot->max_lag, __ATOMIC_RELAXED));
+}
+
 void observer_cleanup() {
+    if (watch_filters) {
+        __atomic_store_n(&watch_filters[observer_id].active, 0, __ATOMIC_RELEASE);
+        close_watch_filters(watch_filters, MAX_OBSERVERS);
+        watch_filters = NULL;
+    }
     if (observer_pipe != -1) {
         close(observer_pipe);
         observer_pipe = -1;
     }
+    if (relay_fd != -1) {
+        close(relay_fd);
+        relay_fd = -1;
+    }
 }
 
 void signal_handler(int sig) {
@@ -91,13 +190,41 @@ void signal_handler(int sig) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Использовано %s <ID_наблюдателя>\n", argv[0]);
+    int option;
+    int policy;
+    while ((option = getopt(argc, argv, "e:f:rd:p:w:s:")) != -1) {
+        switch (option) {
+            case 'e': watch_filter.kinds = event_kinds_for(optarg); break;
+            case 'f': watch_filter.fighters = fighter_set_for(optarg); break;
+            case 'r': watch_filter.kinds = EVENT_RESULT; break;
+            case 'd': watch_filter.draw_sample = atoi(optarg); break;
+            case 'p':
+                policy = watch_policy_for(optarg);
+                watch_filter.policy = policy;
+                if (policy < 0) {
+                    watch_filter.kinds = 0;
+                }
+                break;
+            case 'w': watch_filter.block_ms = atoi(optarg); break;
+            case 's': snprintf(relay_socket, sizeof(relay_socket), "%s", optarg); break;
+            default: watch_filter.kinds = 0; break;
+        }
+        if (option == 'f' && watch_filter.fighters == 0) {
+            watch_filter.kinds = 0;
+        }
+    }
+
+    if (optind != argc - 1 || watch_filter.kinds == 0 || watch_filter.draw_sample < 1) {
+        printf("Использовано %s [-e события] [-f бойцы] [-r] [-d N] [-p политика] [-w мс] <ID_наблюдателя>\n", argv[0]);
+        printf("       %s [-e события] [-f бойцы] [-r] [-d N] -s сокет_ретранслятора <ID_зрителя>\n", argv[0]);
+        printf("События: tournament,round,schedule,start,draw,result,fighter; -r только результаты;\n");
+        printf("-f список ID бойцов через запятую; -d показывать каждую N-ю ничью.\n");
+        printf("Политики: drop-newest, drop-oldest, coalesce, block (-w мс, не больше %d).\n", WATCH_BLOCK_MAX_MS);
         return 1;
     }
 
-    observer_id = atoi(argv[1]);
-    if (observer_id < 0 || observer_id >= MAX_OBSERVERS) {
+    observer_id = atoi(argv[optind]);
+    if (observer_id < 0 || (observer_id >= MAX_OBSERVERS && !relay_socket[0])) {
         printf("Неверный ID наблюдателя. Должен быть от 0 до %d\n", MAX_OBSERVERS-1);
         return 1;
     }
@@ -107,15 +234,31 @@ int main(int argc, char *argv[]) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
-    if (create_watch_channel(observer_id) == -1) {
-        printf("Проблема с созданием канала.\n");
-        return 1;
-    }
+    if (relay_socket[0]) {
+        if (!wait_for_entry(relay_socket, TOURNAMENT_WAIT_SEC) || (relay_fd = connect_relay()) == -1) {
+            printf("Ретранслятор %s недоступен.\n", relay_socket);
+            return 1;
+        }
+        watch_filter.active = 1;
+    } else {
+        if (create_watch_channel(observer_id) == -1) {
+            printf("Проблема с созданием канала.\n");
+            return 1;
+        }
 
+        if (!wait_for_entry(observer_pipe_path, TOURNAMENT_WAIT_SEC)) {
+            printf("Турнир не запущен в течение данного времени.\n");
+            return 1;
+        }
+
+        register_filter();
+    }
     printf("Ожидание событий турнира...\n\n");
 
     DuelMessage incoming_msg;
     int msg_count = 0;
+    unsigned int expected_seq = 1;
+    unsigned int missed = 0;
     int empty_reads = 0;
     int max_empty_reads = 1000;
 
@@ -123,9 +266,24 @@ int main(int argc, char *argv[]) {
         if (get_duel_update(&incoming_msg)) {
             empty_reads = 0;
 
+            unsigned int seq = incoming_msg.event_seq;
+            if (seq != 0 && seq > expected_seq) {
+                printf("   (пропущено событий: %u)\n", seq - expected_seq);
+                missed += seq - expected_seq;
+            } else if (seq != 0 && seq < expected_seq && missed > 0) {
+                missed--;
+            }
+            if (seq >= expected_seq) {
+                expected_seq = seq + 1;
+            }
+            if (relay_socket[0] &&
+                !watcher_wants(&watch_filter, incoming_msg.kind, incoming_msg.from_id, incoming_msg.against_id)) {
+                continue;
+            }
+
             printf("[%d] %s\n", ++msg_count, incoming_msg.text);
 
-            if (incoming_msg.is_result) {
+            if (incoming_msg.is_result && gesture_init(incoming_msg.gesture_count)) {
                 printf("   %s vs %s\n",
                        gesture_name(incoming_msg.move1),
                        gesture_name(incoming_msg.move2));
@@ -151,7 +309,8 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    report_losses();
     observer_cleanup();
-    printf("Наблюдатель %d завершил работу. Событий: %d.\n", observer_id, msg_count);
+    printf("Наблюдатель %d завершил работу. Событий: %d, пропущено: %u.\n", observer_id, msg_count, missed);
     return 0;
 }
@@ -0,0 +1,424 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "gesture.h"
+#include "watch_filter.h"
+#include "duel_message.h"
+#include "wait_entry.h"
+
+#define SHM_NAME "/battle_arena_10"
+#define READY_SEM_NAME "/battle_ready_10"
+#define RELAY_SOCKET_PATH "/tmp/battle_relay_10.sock"
+#define TOURNAMENT_WAIT_SEC 300
+#define RELAY_LOG_SIZE 1024
+#define RELAY_BATCH 64
+#define RELAY_EVENTS 256
+#define RELAY_TICK_MS 100
+#define RELAY_DRAIN_MS 1000
+
+typedef struct {
+    int fd;
+    int index;
+    unsigned long long cursor;
+    DuelMessage partial;
+    size_t offset;
+    int waiting_output;
+    unsigned long long sent;
+    unsigned long long dropped;
+} RelayClient;
+
+DuelMessage event_log[RELAY_LOG_SIZE];
+unsigned long long log_head;
+
+RelayClient **clients_by_fd;
+int *client_fds;
+int client_count;
+int client_limit;
+int peak_clients;
+unsigned long long total_clients;
+unsigned long long total_dropped;
+
+int epoll_fd = -1;
+int listen_fd = -1;
+int pipe_fd = -1;
+int pipe_keeper = -1;
+int relay_id;
+char socket_path[108] = RELAY_SOCKET_PATH;
+char pipe_path[64];
+WatchFilter *watch_filters;
+volatile sig_atomic_t relay_stopped;
+
+int check_tournament_finished() {
+    int fd = shm_open(SHM_NAME, O_RDONLY, 0666);
+    if (fd == -1) {
+        return 1;
+    }
+    close(fd);
+    return 0;
+}
+
+void raise_file_limit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    client_limit = limit.rlim_cur > 1024 * 1024 ? 1024 * 1024 : (int)limit.rlim_cur;
+}
+
+int watch_fd_events(int fd, unsigned int events, int op) {
+    struct epoll_event event = {.events = events, .data.fd = fd};
+    return epoll_ctl(epoll_fd, op, fd, &event);
+}
+
+void drop_client(RelayClient *client) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    total_dropped += client->dropped;
+
+    int last_fd = client_fds[--client_count];
+    client_fds[client->index] = last_fd;
+    clients_by_fd[last_fd]->index = client->index;
+    clients_by_fd[client->fd] = NULL;
+    free(client);
+}
+
+int send_partial(RelayClient *client) {
+    while (client->offset > 0) {
+        ssize_t sent = send(client->fd, (char *)&client->partial + client->offset,
+                            sizeof(DuelMessage) - client->offset, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+        }
+        client->offset = (client->offset + sent) % sizeof(DuelMessage);
+        client->sent += client->offset == 0;
+    }
+    return 0;
+}
+
+int send_backlog(RelayClient *client) {
+    if (log_head - client->cursor > RELAY_LOG_SIZE) {
+        client->dropped += log_head - RELAY_LOG_SIZE - client->cursor;
+        client->cursor = log_head - RELAY_LOG_SIZE;
+    }
+
+    while (client->cursor < log_head) {
+        struct iovec chunks[2];
+        int chunk_count = 0;
+        unsigned long long first = client->cursor % RELAY_LOG_SIZE;
+        unsigned long long pending = log_head - client->cursor;
+        unsigned long long run = pending < RELAY_LOG_SIZE - first ? pending : RELAY_LOG_SIZE - first;
+
+        chunks[chunk_count].iov_base = &event_log[first];
+        chunks[chunk_count++].iov_len = run * sizeof(DuelMessage);
+        if (run < pending) {
+            chunks[chunk_count].iov_base = &event_log[0];
+            chunks[chunk_count++].iov_len = (pending - run) * sizeof(DuelMessage);
+        }
+
+        struct msghdr message = {.msg_iov = chunks, .msg_iovlen = chunk_count};
+        ssize_t sent = sendmsg(client->fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+        }
+
+        client->cursor += sent / sizeof(DuelMessage);
+        client->sent += sent / sizeof(DuelMessage);
+        if (sent % sizeof(DuelMessage)) {
+            client->partial = event_log[client->cursor % RELAY_LOG_SIZE];
+            client->offset = sent % sizeof(DuelMessage);
+            client->cursor++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int flush_client(RelayClient *client) {
+    int blocked = send_partial(client);
+    if (blocked == 0) {
+        blocked = send_backlog(client);
+    }
+    if (blocked < 0) {
+        return 0;
+    }
+
+    int waiting = client->offset > 0 || client->cursor < log_head;
+    if (waiting != client->waiting_output) {
+        watch_fd_events(client->fd, EPOLLRDHUP | (waiting ? EPOLLOUT : 0), EPOLL_CTL_MOD);
+        client->waiting_output = waiting;
+    }
+    return 1;
+}
+
+void accept_clients() {
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        RelayClient *client = fd < client_limit ? calloc(1, sizeof(RelayClient)) : NULL;
+        if (client == NULL || watch_fd_events(fd, EPOLLRDHUP, EPOLL_CTL_ADD) == -1) {
+            free(client);
+            close(fd);
+            continue;
+        }
+
+        client->fd = fd;
+        client->index = client_count;
+        client->cursor = log_head;
+        clients_by_fd[fd] = client;
+        client_fds[client_count++] = fd;
+        total_clients++;
+        if (client_count > peak_clients) {
+            peak_clients = client_count;
+        }
+    }
+}
+
+int read_events() {
+    DuelMessage batch[RELAY_BATCH];
+    ssize_t length;
+    do {
+        length = read(pipe_fd, batch, sizeof(batch));
+    } while (length == -1 && errno == EINTR);
+    if (length <= 0) {
+        return 0;
+    }
+
+    int count = length / sizeof(DuelMessage);
+    for (int i = 0; i < count; i++) {
+        event_log[log_head % RELAY_LOG_SIZE] = batch[i];
+        log_head++;
+    }
+
+    for (int i = 0; i < client_count; ) {
+        RelayClient *client = clients_by_fd[client_fds[i]];
+        if (!client->waiting_output && !flush_client(client)) {
+            drop_client(client);
+            continue;
+        }
+        i++;
+    }
+    return count;
+}
+
+void register_relay() {
+    watch_filters = open_watch_filters(MAX_OBSERVERS, 0);
+    if (watch_filters == NULL) {
+        return;
+    }
+
+    WatchFilter *slot = &watch_filters[relay_id];
+    memset(slot, 0, sizeof(WatchFilter));
+    slot->kinds = EVENT_ALL;
+    slot->draw_sample = 1;
+    slot->policy = WATCH_DROP_OLDEST;
+    __atomic_store_n(&slot->active, 1, __ATOMIC_RELEASE);
+}
+
+void announce_ready() {
+    sem_t *ready_sem = sem_open(READY_SEM_NAME, 0);
+    if (ready_sem != SEM_FAILED) {
+        sem_post(ready_sem);
+        sem_close(ready_sem);
+    }
+}
+
+int open_listener() {
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        return 0;
+    }
+
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", socket_path);
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) == -1 ||
+        listen(listen_fd, SOMAXCONN) == -1) {
+        return 0;
+    }
+    chmod(socket_path, 0666);
+    return 1;
+}
+
+void relay_cleanup() {
+    while (client_count > 0) {
+        drop_client(clients_by_fd[client_fds[0]]);
+    }
+    if (watch_filters) {
+        __atomic_store_n(&watch_filters[relay_id].active, 0, __ATOMIC_RELEASE);
+        close_watch_filters(watch_filters, MAX_OBSERVERS);
+        watch_filters = NULL;
+    }
+    if (listen_fd != -1) {
+        close(listen_fd);
+        unlink(socket_path);
+    }
+    if (pipe_fd != -1) {
+        close(pipe_fd);
+    }
+    if (pipe_keeper != -1) {
+        close(pipe_keeper);
+    }
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    free(clients_by_fd);
+    free(client_fds);
+}
+
+void signal_handler(int sig) {
+    (void)sig;
+    relay_stopped = 1;
+}
+
+void drain_clients() {
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        int waiting = 0;
+        for (int i = 0; i < client_count; ) {
+            RelayClient *client = clients_by_fd[client_fds[i]];
+            if (!flush_client(client)) {
+                drop_client(client);
+                continue;
+            }
+            waiting += client->waiting_output;
+            i++;
+        }
+        if (waiting == 0) {
+            return;
+        }
+        usleep(10000);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000 < RELAY_DRAIN_MS);
+}
+
+int main(int argc, char *argv[]) {
+    int option;
+    while ((option = getopt(argc, argv, "s:")) != -1) {
+        switch (option) {
+            case 's': snprintf(socket_path, sizeof(socket_path), "%s", optarg); break;
+            default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1) {
+        printf("Использовано %s [-s сокет] <ID_наблюдателя>\n", argv[0]);
+        return 1;
+    }
+
+    relay_id = atoi(argv[optind]);
+    if (relay_id < 0 || relay_id >= MAX_OBSERVERS) {
+        printf("Неверный ID наблюдателя. Должен быть от 0 до %d\n", MAX_OBSERVERS-1);
+        return 1;
+    }
+
+    printf("------ Ретранслятор турнира (наблюдатель %d) ------\n", relay_id);
+    struct sigaction stop = {.sa_handler = signal_handler};
+    sigaction(SIGINT, &stop, NULL);
+    sigaction(SIGTERM, &stop, NULL);
+
+    raise_file_limit();
+    clients_by_fd = calloc(client_limit, sizeof(RelayClient *));
+    client_fds = calloc(client_limit, sizeof(int));
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (clients_by_fd == NULL || client_fds == NULL || epoll_fd == -1) {
+        perror("Проблема с подготовкой ретранслятора.");
+        relay_cleanup();
+        return 1;
+    }
+
+    if (!open_listener()) {
+        perror("Проблема с созданием сокета.");
+        relay_cleanup();
+        return 1;
+    }
+
+    snprintf(pipe_path, sizeof(pipe_path), "%s_%d", OBSERVER_PATH_BASE, relay_id);
+    if (!wait_for_entry(pipe_path, TOURNAMENT_WAIT_SEC)) {
+        printf("Турнир не запущен в течение данного времени.\n");
+        relay_cleanup();
+        return 1;
+    }
+
+    register_relay();
+    pipe_fd = open(pipe_path, O_RDONLY | O_NONBLOCK);
+    pipe_keeper = open(pipe_path, O_WRONLY | O_NONBLOCK);
+    if (pipe_fd == -1 || watch_fd_events(pipe_fd, EPOLLIN, EPOLL_CTL_ADD) == -1 ||
+        watch_fd_events(listen_fd, EPOLLIN, EPOLL_CTL_ADD) == -1) {
+        printf("Проблема с подключением к каналу наблюдателя.\n");
+        relay_cleanup();
+        return 1;
+    }
+    announce_ready();
+    printf("Клиенты подключаются к %s, не больше %d.\n", socket_path, client_limit);
+
+    struct epoll_event events[RELAY_EVENTS];
+    int idle_ticks = 0;
+    while (!relay_stopped) {
+        int ready = epoll_wait(epoll_fd, events, RELAY_EVENTS, RELAY_TICK_MS);
+        if (ready == -1 && errno != EINTR) {
+            perror("Проблема с ожиданием событий.");
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == pipe_fd) {
+                while (read_events() == RELAY_BATCH) {
+                }
+            } else if (fd == listen_fd) {
+                accept_clients();
+            } else if (clients_by_fd[fd]) {
+                RelayClient *client = clients_by_fd[fd];
+                if ((events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) || !flush_client(client)) {
+                    drop_client(client);
+                }
+            }
+        }
+
+        if (ready == 0 && ++idle_ticks % 10 == 0 && check_tournament_finished()) {
+            break;
+        } else if (ready > 0) {
+            idle_ticks = 0;
+        }
+    }
+
+    while (read_events() > 0) {
+    }
+    drain_clients();
+    relay_cleanup();
+    printf("Ретранслятор завершил работу. Событий: %llu, клиентов: %llu (одновременно до %d), потеряно у клиентов: %llu.\n",
+           log_head, total_clients, peak_clients, total_dropped);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include <stdlib.h>
+
+#include "strategy_plugin.h"
+
+typedef struct {
+    int gesture_count;
+    int last_move;
+} BeatLast;
+
+void *beat_last_create(int gesture_count) {
+    BeatLast *state = malloc(sizeof(BeatLast));
+    if (state) {
+        state->gesture_count = gesture_count;
+        state->last_move = -1;
+    }
+    return state;
+}
+
+void beat_last_destroy(void *state) {
+    free(state);
+}
+
+void beat_last_observe(void *state, int rival, int move) {
+    (void)rival;
+    ((BeatLast *)state)->last_move = move;
+}
+
+int beat_last_choose(void *state) {
+    BeatLast *self = state;
+    if (self->last_move < 0) {
+        return rand() % self->gesture_count;
+    }
+    return (self->last_move + self->gesture_count - 1) % self->gesture_count;
+}
+
+const StrategyPlugin beat_last = {
+    STRATEGY_PLUGIN_ABI,
+    "beat_last",
+    beat_last_create,
+    beat_last_destroy,
+    beat_last_observe,
+    beat_last_choose
+};
+
+const StrategyPlugin *strategy_plugin(void) {
+    return &beat_last;
+}
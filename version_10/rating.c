@@ -0,0 +1,299 @@
+#include <math.h>
+#include <sched.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rating.h"
+
+unsigned long long rating_hash(const char *name) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++) {
+        hash = (hash ^ *c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+int rating_leader_before(const RatingLeader *first, const RatingLeader *second) {
+    return first->wins > second->wins || (first->wins == second->wins && first->entry < second->entry);
+}
+
+void rating_leader_place(RatingDb *db, int index, RatingLeader leader) {
+    db->header->leaders[index] = leader;
+    db->entries[leader.entry].leader = index + 1;
+}
+
+void rating_leader_sift_up(RatingDb *db, int index) {
+    RatingLeader leader = db->header->leaders[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!rating_leader_before(&db->header->leaders[parent], &leader)) {
+            break;
+        }
+        rating_leader_place(db, index, db->header->leaders[parent]);
+        index = parent;
+    }
+    rating_leader_place(db, index, leader);
+}
+
+void rating_leader_sift_down(RatingDb *db, int index) {
+    RatingHeader *header = db->header;
+    RatingLeader leader = header->leaders[index];
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= (int)header->leader_count) {
+            break;
+        }
+        if (child + 1 < (int)header->leader_count &&
+            rating_leader_before(&header->leaders[child], &header->leaders[child + 1])) {
+            child++;
+        }
+        if (!rating_leader_before(&leader, &header->leaders[child])) {
+            break;
+        }
+        rating_leader_place(db, index, header->leaders[child]);
+        index = child;
+    }
+    rating_leader_place(db, index, leader);
+}
+
+void rating_leader_insert(RatingDb *db, unsigned int entry) {
+    RatingHeader *header = db->header;
+    RatingLeader leader = {entry, db->entries[entry].wins};
+    int index = (int)db->entries[entry].leader - 1;
+    if (index >= 0) {
+        header->leaders[index].wins = leader.wins;
+        rating_leader_sift_down(db, index);
+    } else if (header->leader_count < RATING_LEADERS) {
+        rating_leader_place(db, header->leader_count++, leader);
+        rating_leader_sift_up(db, header->leader_count - 1);
+    } else if (rating_leader_before(&leader, &header->leaders[0])) {
+        db->entries[header->leaders[0].entry].leader = 0;
+        rating_leader_place(db, 0, leader);
+        rating_leader_sift_down(db, 0);
+    }
+}
+
+unsigned int rating_leaders_begin(RatingHeader *header) {
+    unsigned int seq = header->leaders_seq;
+    seq += seq & 1 ? 2 : 1;
+    __atomic_store_n(&header->leaders_seq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return seq;
+}
+
+void rating_leaders_rebuild(RatingDb *db) {
+    RatingHeader *header = db->header;
+    unsigned int seq = rating_leaders_begin(header);
+    header->leader_count = 0;
+    for (unsigned int i = 0; i < header->capacity; i++) {
+        RatingEntry *entry = &db->entries[i];
+        if (!entry->used) {
+            continue;
+        }
+        entry->leader = 0;
+        if (entry->wins > 0) {
+            rating_leader_insert(db, i);
+        }
+    }
+    __atomic_store_n(&header->leaders_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+int rating_rollback(RatingDb *db) {
+    RatingHeader *header = db->header;
+    unsigned int node = __atomic_load_n(&header->pending, __ATOMIC_ACQUIRE);
+    if (node == 0) {
+        return 0;
+    }
+    int rolled_back = 0;
+    for (int i = 0; i < 2 && node < 64 && !(header->applied & (1ULL << node)); i++) {
+        if (header->pending_entries[i] >= header->capacity) {
+            continue;
+        }
+        RatingEntry *entry = &db->entries[header->pending_entries[i]];
+        entry->rating = header->pending_ratings[i];
+        entry->games = header->pending_games[i];
+        if (i == 0) {
+            entry->wins = header->pending_wins;
+        }
+        rolled_back = 1;
+    }
+    __atomic_store_n(&header->pending, 0, __ATOMIC_RELEASE);
+    return rolled_back;
+}
+
+int rating_open(RatingDb *db, const char *path, int writable) {
+    memset(db, 0, sizeof(RatingDb));
+    int fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0666);
+    if (fd == -1) {
+        return 0;
+    }
+
+    struct stat info;
+    size_t size = sizeof(RatingHeader) + (size_t)RATING_DB_CAPACITY * sizeof(RatingEntry);
+    int fresh = writable && fstat(fd, &info) == 0 && info.st_size == 0;
+    if (fresh && ftruncate(fd, size) == -1) {
+        close(fd);
+        return 0;
+    }
+    if (!fresh && (fstat(fd, &info) == -1 || info.st_size < (off_t)sizeof(RatingHeader))) {
+        close(fd);
+        return 0;
+    }
+    if (!fresh) {
+        size = info.st_size;
+    }
+
+    void *mapped = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return 0;
+    }
+
+    RatingHeader *header = mapped;
+    if (fresh) {
+        header->capacity = RATING_DB_CAPACITY;
+        __atomic_store_n(&header->magic, RATING_DB_MAGIC, __ATOMIC_RELEASE);
+    }
+    if (header->magic != RATING_DB_MAGIC ||
+        size < sizeof(RatingHeader) + (size_t)header->capacity * sizeof(RatingEntry) ||
+        (header->capacity & (header->capacity - 1)) != 0) {
+        munmap(mapped, size);
+        return 0;
+    }
+
+    db->header = header;
+    db->entries = (RatingEntry *)(header + 1);
+    db->size = size;
+    db->writable = writable;
+    if (writable && (rating_rollback(db) || (header->leaders_seq & 1))) {
+        rating_leaders_rebuild(db);
+    }
+    return 1;
+}
+
+void rating_close(RatingDb *db) {
+    if (db->header) {
+        if (db->writable) {
+            msync(db->header, db->size, MS_ASYNC);
+        }
+        munmap(db->header, db->size);
+        db->header = NULL;
+    }
+}
+
+int rating_find(RatingDb *db, const char *name, int create) {
+    if (db->header == NULL) {
+        return -1;
+    }
+    unsigned int mask = db->header->capacity - 1;
+    unsigned long long hash = rating_hash(name);
+    for (unsigned int probe = 0; probe <= mask; probe++) {
+        unsigned int index = (unsigned int)(hash + probe) & mask;
+        RatingEntry *entry = &db->entries[index];
+        if (!__atomic_load_n(&entry->used, __ATOMIC_ACQUIRE)) {
+            if (!create || !db->writable || db->header->count >= db->header->capacity / 4 * 3) {
+                return -1;
+            }
+            entry->hash = hash;
+            strncpy(entry->name, name, RATING_NAME_SIZE - 1);
+            entry->rating = RATING_DEFAULT;
+            entry->games = 0;
+            entry->wins = 0;
+            entry->leader = 0;
+            __atomic_store_n(&entry->used, 1, __ATOMIC_RELEASE);
+            db->header->count++;
+            return index;
+        }
+        if (entry->hash == hash && strncmp(entry->name, name, RATING_NAME_SIZE - 1) == 0) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+double rating_of(const RatingDb *db, int entry) {
+    return db->header && entry >= 0 ? db->entries[entry].rating : RATING_DEFAULT;
+}
+
+int rating_record(RatingDb *db, unsigned int tournament, int node, int winner, int loser) {
+    RatingHeader *header = db->header;
+    if (header == NULL || !db->writable || winner < 0 || loser < 0 || winner == loser || node < 1 || node >= 64) {
+        return 0;
+    }
+    if (header->tournament != tournament) {
+        header->applied = 0;
+        header->tournament = tournament;
+    }
+    if (header->applied & (1ULL << node)) {
+        return 0;
+    }
+
+    RatingEntry *first = &db->entries[winner];
+    RatingEntry *second = &db->entries[loser];
+    header->pending_entries[0] = winner;
+    header->pending_entries[1] = loser;
+    header->pending_ratings[0] = first->rating;
+    header->pending_ratings[1] = second->rating;
+    header->pending_games[0] = first->games;
+    header->pending_games[1] = second->games;
+    header->pending_wins = first->wins;
+    __atomic_store_n(&header->pending, node, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    double expected = 1.0 / (1.0 + pow(10.0, (second->rating - first->rating) / 400.0));
+    double change = RATING_K * (1.0 - expected);
+    first->rating += change;
+    second->rating -= change;
+    first->games++;
+    second->games++;
+    first->wins++;
+
+    unsigned int seq = rating_leaders_begin(header);
+    rating_leader_insert(db, winner);
+    __atomic_store_n(&header->leaders_seq, seq + 1, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&header->applied, header->applied | (1ULL << node), __ATOMIC_RELEASE);
+    __atomic_store_n(&header->pending, 0, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int rating_leaders(const RatingDb *db, RatingLeader *leaders) {
+    const RatingHeader *header = db->header;
+    if (header == NULL) {
+        return 0;
+    }
+    int count;
+    for (int attempt = 0;; attempt++) {
+        if (attempt == RATING_LEADER_RETRIES) {
+            return 0;
+        }
+        unsigned int begin = __atomic_load_n(&header->leaders_seq, __ATOMIC_ACQUIRE);
+        if (begin & 1) {
+            sched_yield();
+            continue;
+        }
+        count = header->leader_count;
+        if (count > RATING_LEADERS) {
+            count = RATING_LEADERS;
+        }
+        memcpy(leaders, header->leaders, sizeof(RatingLeader) * count);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->leaders_seq, __ATOMIC_RELAXED) == begin) {
+            break;
+        }
+    }
+
+    for (int i = 1; i < count; i++) {
+        RatingLeader leader = leaders[i];
+        int j = i;
+        while (j > 0 && rating_leader_before(&leader, &leaders[j - 1])) {
+            leaders[j] = leaders[j - 1];
+            j--;
+        }
+        leaders[j] = leader;
+    }
+    return count;
+}
@@ -0,0 +1,60 @@
+#ifndef RATING_H
+#define RATING_H
+
+#include <stddef.h>
+
+#define RATING_DB_PATH "/tmp/battle_ratings_10.db"
+#define RATING_DB_MAGIC 0x32304452
+#define RATING_DB_CAPACITY (1u << 22)
+#define RATING_NAME_SIZE 32
+#define RATING_DEFAULT 1500.0
+#define RATING_K 32.0
+#define RATING_LEADERS 8
+#define RATING_LEADER_RETRIES 1000
+
+typedef struct {
+    unsigned long long hash;
+    char name[RATING_NAME_SIZE];
+    double rating;
+    unsigned int games;
+    unsigned int used;
+    unsigned int wins;
+    unsigned int leader;
+} __attribute__((aligned(64))) RatingEntry;
+
+typedef struct {
+    unsigned int entry;
+    unsigned int wins;
+} RatingLeader;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int capacity;
+    unsigned int count;
+    unsigned int tournament;
+    unsigned long long applied;
+    unsigned int pending;
+    unsigned int pending_entries[2];
+    unsigned int pending_games[2];
+    unsigned int pending_wins;
+    double pending_ratings[2];
+    unsigned int leaders_seq;
+    unsigned int leader_count;
+    RatingLeader leaders[RATING_LEADERS];
+} __attribute__((aligned(64))) RatingHeader;
+
+typedef struct {
+    RatingHeader *header;
+    RatingEntry *entries;
+    size_t size;
+    int writable;
+} RatingDb;
+
+int rating_open(RatingDb *db, const char *path, int writable);
+void rating_close(RatingDb *db);
+int rating_find(RatingDb *db, const char *name, int create);
+double rating_of(const RatingDb *db, int entry);
+int rating_record(RatingDb *db, unsigned int tournament, int node, int winner, int loser);
+int rating_leaders(const RatingDb *db, RatingLeader *leaders);
+
+#endif
@@ -10,30 +10,14 @@
 #include <time.h>
 #include <fcntl.h>
 
+#include "gesture.h"
+#include "watch_filter.h"
+#include "duel_message.h"
+
 #define MAX_FIGHTERS 32
-#define MSG_SIZE 256
-#define OBSERVER_PATH_BASE "/tmp/battle_observer_10"
-#define MAX_OBSERVERS 10
 #define SHM_NAME "/battle_arena_10"
 #define SEM_NAME "/battle_sem_10"
 
-typedef enum {
-    ROCK = 0,
-    SCISSORS = 1,
-    PAPER = 2
-} HandSign;
-
-typedef struct {
-    char text[MSG_SIZE];
-    int from_id;
-    int against_id;
-    int round_count;
-    int is_result;
-    HandSign move1;
-    HandSign move2;
-    int duel_rounds;
-} DuelMessage;
-
 typedef struct {
     int id;
     int active;
@@ -82,7 +66,7 @@ void sem_unlock(sem_t *sem) {
     } while (result == -1 && errno == EINTR);
 }
 
-void send_to_watchers(const char* message, int from_id, int against_id,
+void send_to_watchers(EventKind kind, const char* message, int from_id, int against_id,
                       int is_result, HandSign move1, HandSign move2, int duel_rounds) {
     DuelMessage msg;
     strncpy(msg.text, message, MSG_SIZE-1);
@@ -94,6 +78,9 @@ void send_to_watchers(const char* message, int from_id, int against_id,
     msg.move1 = move1;
     msg.move2 = move2;
     msg.duel_rounds = duel_rounds;
+    msg.gesture_count = DEFAULT_GESTURES;
+    msg.event_seq = 0;
+    msg.kind = kind;
 
     for (int i = 0; i < MAX_OBSERVERS; i++) {
         char pipe_path[64];
@@ -134,7 +121,7 @@ void signal_handler(int sig) {
     combat_zone->finished = 1;
     combat_zone->terminated = 1;
     sem_unlock(combat_sem);
-    send_to_watchers("Турнир остановлен по сигналу.", -1, -1, 0, ROCK, ROCK, 0);
+    send_to_watchers(EVENT_TOURNAMENT, "Турнир остановлен по сигналу.", -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
     sleep(1);
     cleanup_resources();
     exit(0);
@@ -205,7 +192,7 @@ void setup_round() {
         printf("Организован бой:\n Боец %d vs Боец %d\n", fighter1, fighter2);
         char message[MSG_SIZE];
         snprintf(message, MSG_SIZE, "Организован бой: Боец %d vs Боец %d", fighter1, fighter2);
-        send_to_watchers(message, -1, -1, 0, ROCK, ROCK, 0);
+        send_to_watchers(EVENT_SCHEDULE, message, -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
     }
 
     combat_zone->round_num++;
@@ -213,7 +200,7 @@ void setup_round() {
 
     char round_msg[MSG_SIZE];
     snprintf(round_msg, MSG_SIZE, "Начало раунда %d.", combat_zone->round_num);
-    send_to_watchers(round_msg, -1, -1, 0, ROCK, ROCK, 0);
+    send_to_watchers(EVENT_ROUND, round_msg, -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
 
     sem_unlock(combat_sem);
 }
@@ -268,7 +255,7 @@ int main(int argc, char *argv[]) {
         combat_zone->fighters[i].active = 1;
         combat_zone->fighters[i].connected = 0;
         combat_zone->fighters[i].victories = 0;
-        combat_zone->fighters[i].gesture = ROCK;
+        combat_zone->fighters[i].gesture = NO_GESTURE;
         combat_zone->fighters[i].has_rival = 0;
         combat_zone->fighters[i].rival_id = -1;
     }
@@ -316,11 +303,11 @@ int main(int argc, char *argv[]) {
 
     printf("\nЗапуск наблюдателей:\n");
     printf("Теперь у вас есть 40 секунд чтобы запустить наблюдателей.\n");
-    send_to_watchers("Турнир начал работу.", -1, -1, 0, ROCK, ROCK, 0);
+    send_to_watchers(EVENT_TOURNAMENT, "Турнир начал работу.", -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
     sleep(40);
 
     printf("\n------ Турнир начинается! ------\n");
-    send_to_watchers("Турнир начинается!", -1, -1, 0, ROCK, ROCK, 0);
+    send_to_watchers(EVENT_TOURNAMENT, "Турнир начинается!", -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
     sleep(2);
 
     int round = 0;
@@ -370,7 +357,7 @@ int main(int argc, char *argv[]) {
             printf("\nТурнир завершен! Победитель: Боец %d\n", i);
             char winner_msg[MSG_SIZE];
             snprintf(winner_msg, MSG_SIZE, "Турнир завершен! Победитель: Боец %d", i);
-            send_to_watchers(winner_msg, -1, -1, 0, ROCK, ROCK, 0);
+            send_to_watchers(EVENT_TOURNAMENT, winner_msg, -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
             winner_found = 1;
             break;
         }
@@ -378,12 +365,12 @@ int main(int argc, char *argv[]) {
     
     if (!winner_found) {
         printf("\nТурнир завершен! Победитель не определен.\n");
-        send_to_watchers("Турнир завершен! Победитель не определен.", -1, -1, 0, ROCK, ROCK, 0);
+        send_to_watchers(EVENT_TOURNAMENT, "Турнир завершен! Победитель не определен.", -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
     }
     sem_unlock(combat_sem);
 
     printf("Все бои завершены.\n");
-    send_to_watchers("Все бои завершены.", -1, -1, 0, ROCK, ROCK, 0);
+    send_to_watchers(EVENT_TOURNAMENT, "Все бои завершены.", -1, -1, 0, NO_GESTURE, NO_GESTURE, 0);
     sleep(2);
     cleanup_resources();
     return 0;
@@ -0,0 +1,97 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "stats.h"
+
+TournamentStats *open_stats(int create, int reset) {
+    int fd = shm_open(STATS_SHM_NAME, create ? O_CREAT | O_RDWR : O_RDWR, 0666);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (create && ftruncate(fd, sizeof(TournamentStats)) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    TournamentStats *stats = mmap(NULL, sizeof(TournamentStats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED) {
+        return NULL;
+    }
+    if (reset) {
+        memset(stats, 0, sizeof(TournamentStats));
+    }
+    return stats;
+}
+
+void close_stats(TournamentStats *stats) {
+    if (stats) {
+        munmap(stats, sizeof(TournamentStats));
+    }
+}
+
+void stats_add(unsigned long long *counter, unsigned long long amount) {
+    __atomic_fetch_add(counter, amount, __ATOMIC_RELAXED);
+}
+
+unsigned long long stats_load(const unsigned long long *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+int stats_fighter_valid(int fighter) {
+    return fighter >= 0 && fighter < STATS_MAX_FIGHTERS;
+}
+
+int stats_round_valid(int round) {
+    return round >= 0 && round < STATS_MAX_ROUNDS;
+}
+
+void stats_exchange(TournamentStats *stats, int fighter, HandSign move, int draw) {
+    if (stats == NULL || !stats_fighter_valid(fighter) || move < 0 || move >= MAX_GESTURES) {
+        return;
+    }
+    stats_add(&stats->fighters[fighter].gestures[move], 1);
+    if (draw) {
+        stats_add(&stats->fighters[fighter].draws, 1);
+    }
+}
+
+void stats_round_exchange(TournamentStats *stats, int round, int draw) {
+    if (stats == NULL || !stats_round_valid(round)) {
+        return;
+    }
+    stats_add(&stats->rounds[round].exchanges, 1);
+    if (draw) {
+        stats_add(&stats->rounds[round].draws, 1);
+    }
+}
+
+void stats_duel(TournamentStats *stats, int round, int winner, int loser, int exchanges) {
+    if (stats == NULL || !stats_fighter_valid(winner) || !stats_fighter_valid(loser)) {
+        return;
+    }
+    FighterStats *first = &stats->fighters[winner];
+    FighterStats *second = &stats->fighters[loser];
+    stats_add(&first->duels, 1);
+    stats_add(&second->duels, 1);
+    stats_add(&first->wins, 1);
+    stats_add(&second->losses, 1);
+    stats_add(&first->exchanges, exchanges);
+    stats_add(&second->exchanges, exchanges);
+    if (stats_round_valid(round)) {
+        stats_add(&stats->rounds[round].duels, 1);
+    }
+}
+
+void stats_walkover(TournamentStats *stats, int round, int winner) {
+    if (stats == NULL || !stats_fighter_valid(winner)) {
+        return;
+    }
+    stats_add(&stats->fighters[winner].walkovers, 1);
+    if (stats_round_valid(round)) {
+        stats_add(&stats->rounds[round].walkovers, 1);
+    }
+}
+
@@ -0,0 +1,42 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "gesture.h"
+
+#define STATS_SHM_NAME "/battle_stats_10"
+#define STATS_MAX_FIGHTERS 32
+#define STATS_MAX_ROUNDS 8
+
+typedef struct {
+    unsigned long long duels;
+    unsigned long long wins;
+    unsigned long long losses;
+    unsigned long long walkovers;
+    unsigned long long draws;
+    unsigned long long exchanges;
+    unsigned long long gestures[MAX_GESTURES];
+} __attribute__((aligned(64))) FighterStats;
+
+typedef struct {
+    unsigned long long duels;
+    unsigned long long walkovers;
+    unsigned long long draws;
+    unsigned long long exchanges;
+} __attribute__((aligned(64))) RoundStats;
+
+typedef struct {
+    int total_count;
+    int gesture_count;
+    FighterStats fighters[STATS_MAX_FIGHTERS];
+    RoundStats rounds[STATS_MAX_ROUNDS];
+} TournamentStats;
+
+TournamentStats *open_stats(int create, int reset);
+void close_stats(TournamentStats *stats);
+void stats_exchange(TournamentStats *stats, int fighter, HandSign move, int draw);
+void stats_round_exchange(TournamentStats *stats, int round, int draw);
+void stats_duel(TournamentStats *stats, int round, int winner, int loser, int exchanges);
+void stats_walkover(TournamentStats *stats, int round, int winner);
+unsigned long long stats_load(const unsigned long long *counter);
+
+#endif
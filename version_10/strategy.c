@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include "strategy.h"
+
+const char *strategy_names[STRATEGY_KINDS] = {"random", "frequency", "markov", "mixed", "plugin"};
+
+int strategy_kind_for(const char *name) {
+    for (int kind = 0; kind < STRATEGY_PLUGIN; kind++) {
+        if (strcmp(strategy_names[kind], name) == 0) {
+            return kind;
+        }
+    }
+    return -1;
+}
+
+const char *strategy_name(const Strategy *strategy) {
+    if (strategy->kind == STRATEGY_PLUGIN) {
+        return strategy->plugin ? strategy->plugin->name : "random";
+    }
+    return strategy_names[strategy->kind];
+}
+
+void forget_rival(Strategy *strategy, int rival) {
+    if (strategy->kind != STRATEGY_PLUGIN) {
+        memset(&strategy->counts, 0, sizeof(MoveCounts));
+        strategy->counts.context = NO_CONTEXT;
+    }
+    strategy->rival = rival;
+    strategy->seen = 0;
+}
+
+void strategy_init(Strategy *strategy, int kind) {
+    memset(strategy, 0, sizeof(Strategy));
+    strategy->kind = kind;
+    forget_rival(strategy, -1);
+}
+
+int open_plugin(Strategy *strategy) {
+    struct stat info;
+    if (stat(strategy->plugin_path, &info) == -1) {
+        printf("Модуль стратегии %s недоступен.\n", strategy->plugin_path);
+        return 0;
+    }
+    strategy->plugin_inode = info.st_ino;
+    strategy->plugin_mtime = info.st_mtime;
+
+    void *handle = dlopen(strategy->plugin_path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        printf("Проблема с загрузкой модуля стратегии: %s.\n", dlerror());
+        return 0;
+    }
+
+    const StrategyPlugin *(*entry)(void);
+    *(void **)&entry = dlsym(handle, STRATEGY_PLUGIN_SYMBOL);
+    const StrategyPlugin *plugin = entry ? entry() : NULL;
+    if (plugin == NULL || plugin->abi_version != STRATEGY_PLUGIN_ABI ||
+        !plugin->create || !plugin->destroy || !plugin->observe || !plugin->choose) {
+        printf("Модуль %s не реализует интерфейс стратегии версии %d.\n", strategy->plugin_path, STRATEGY_PLUGIN_ABI);
+        dlclose(handle);
+        return 0;
+    }
+
+    void *state = plugin->create(gesture_count());
+    if (state == NULL) {
+        printf("Модуль %s не смог создать состояние стратегии.\n", strategy->plugin_path);
+        dlclose(handle);
+        return 0;
+    }
+
+    strategy->plugin_handle = handle;
+    strategy->plugin = plugin;
+    strategy->plugin_state = state;
+    forget_rival(strategy, -1);
+    return 1;
+}
+
+void strategy_unload(Strategy *strategy) {
+    if (strategy->plugin) {
+        strategy->plugin->destroy(strategy->plugin_state);
+        dlclose(strategy->plugin_handle);
+    }
+    strategy->plugin_handle = NULL;
+    strategy->plugin = NULL;
+    strategy->plugin_state = NULL;
+}
+
+int strategy_load(Strategy *strategy, const char *path) {
+    strategy_unload(strategy);
+    strategy->kind = STRATEGY_PLUGIN;
+    snprintf(strategy->plugin_path, sizeof(strategy->plugin_path), "%s", path);
+    return open_plugin(strategy);
+}
+
+int strategy_reload(Strategy *strategy) {
+    struct stat info;
+    if (strategy->kind != STRATEGY_PLUGIN || stat(strategy->plugin_path, &info) == -1 ||
+        (info.st_ino == strategy->plugin_inode && info.st_mtime == strategy->plugin_mtime)) {
+        return 0;
+    }
+
+    strategy_unload(strategy);
+    return open_plugin(strategy) ? 1 : -1;
+}
+
+void count_move(unsigned short *row, HandSign *best, HandSign move) {
+    if (row[move] == USHRT_MAX) {
+        for (int sign = 0; sign < MAX_GESTURES; sign++) {
+            row[sign] >>= 1;
+        }
+    }
+    if (++row[move] > row[*best]) {
+        *best = move;
+    }
+}
+
+void strategy_observe(Strategy *strategy, int rival, const MoveHistory *history) {
+    if (strategy->kind == STRATEGY_RANDOM) {
+        return;
+    }
+    if (rival != strategy->rival) {
+        forget_rival(strategy, rival);
+    }
+
+    unsigned int head = __atomic_load_n(&history->head, __ATOMIC_ACQUIRE);
+    if (head - strategy->seen > HISTORY_SIZE) {
+        strategy->seen = head - HISTORY_SIZE;
+    }
+
+    MoveCounts *counts = &strategy->counts;
+    for (; strategy->seen != head; strategy->seen++) {
+        HandSign move = history->moves[strategy->seen % HISTORY_SIZE];
+        if (move >= gesture_count()) {
+            continue;
+        }
+        if (strategy->plugin) {
+            strategy->plugin->observe(strategy->plugin_state, rival, move);
+            continue;
+        }
+        int context = counts->context;
+        count_move(counts->frequency, &counts->frequency_best, move);
+        count_move(counts->transitions[context], &counts->transition_best[context], move);
+        counts->context = move;
+    }
+}
+
+HandSign predict_frequency(MoveCounts *counts) {
+    if (counts->frequency[counts->frequency_best] == 0) {
+        return rand() % gesture_count();
+    }
+    return gesture_counter(counts->frequency_best);
+}
+
+HandSign predict_markov(MoveCounts *counts) {
+    int context = counts->context;
+    HandSign best = counts->transition_best[context];
+    if (counts->transitions[context][best] == 0) {
+        return predict_frequency(counts);
+    }
+    return gesture_counter(best);
+}
+
+HandSign strategy_choose(Strategy *strategy) {
+    switch (strategy->kind) {
+        case STRATEGY_FREQUENCY:
+            return predict_frequency(&strategy->counts);
+        case STRATEGY_MARKOV:
+            return predict_markov(&strategy->counts);
+        case STRATEGY_MIXED:
+            if (rand() % 100 < MIX_RANDOM_PERCENT) {
+                return rand() % gesture_count();
+            }
+            return predict_markov(&strategy->counts);
+        case STRATEGY_PLUGIN:
+            if (strategy->plugin) {
+                HandSign move = strategy->plugin->choose(strategy->plugin_state);
+                if (move >= 0 && move < gesture_count()) {
+                    return move;
+                }
+            }
+            return rand() % gesture_count();
+        default:
+            return rand() % gesture_count();
+    }
+}
+
+void history_record(MoveHistory *history, HandSign move) {
+    unsigned int head = history->head;
+    history->moves[head % HISTORY_SIZE] = (unsigned char)move;
+    __atomic_store_n(&history->head, head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,59 @@
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <limits.h>
+#include <sys/types.h>
+
+#include "gesture.h"
+#include "strategy_plugin.h"
+
+#define HISTORY_SIZE 60
+#define NO_CONTEXT MAX_GESTURES
+#define MIX_RANDOM_PERCENT 30
+
+enum {
+    STRATEGY_RANDOM,
+    STRATEGY_FREQUENCY,
+    STRATEGY_MARKOV,
+    STRATEGY_MIXED,
+    STRATEGY_PLUGIN,
+    STRATEGY_KINDS
+};
+
+typedef struct {
+    unsigned int head;
+    unsigned char moves[HISTORY_SIZE];
+} __attribute__((aligned(64))) MoveHistory;
+
+typedef struct {
+    int context;
+    unsigned short frequency[MAX_GESTURES];
+    HandSign frequency_best;
+    unsigned short transitions[MAX_GESTURES + 1][MAX_GESTURES];
+    HandSign transition_best[MAX_GESTURES + 1];
+} MoveCounts;
+
+typedef struct {
+    int kind;
+    int rival;
+    unsigned int seen;
+    MoveCounts counts;
+    void *plugin_handle;
+    const StrategyPlugin *plugin;
+    void *plugin_state;
+    char plugin_path[PATH_MAX];
+    ino_t plugin_inode;
+    time_t plugin_mtime;
+} Strategy;
+
+int strategy_kind_for(const char *name);
+const char *strategy_name(const Strategy *strategy);
+void strategy_init(Strategy *strategy, int kind);
+int strategy_load(Strategy *strategy, const char *path);
+int strategy_reload(Strategy *strategy);
+void strategy_unload(Strategy *strategy);
+void strategy_observe(Strategy *strategy, int rival, const MoveHistory *history);
+HandSign strategy_choose(Strategy *strategy);
+void history_record(MoveHistory *history, HandSign move);
+
+#endif
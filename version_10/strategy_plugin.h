@@ -0,0 +1,18 @@
+#ifndef STRATEGY_PLUGIN_H
+#define STRATEGY_PLUGIN_H
+
+#define STRATEGY_PLUGIN_ABI 1
+#define STRATEGY_PLUGIN_SYMBOL "strategy_plugin"
+
+typedef struct {
+    int abi_version;
+    const char *name;
+    void *(*create)(int gesture_count);
+    void (*destroy)(void *state);
+    void (*observe)(void *state, int rival, int move);
+    int (*choose)(void *state);
+} StrategyPlugin;
+
+const StrategyPlugin *strategy_plugin(void);
+
+#endif
@@ -3,61 +3,116 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include <semaphore.h>
 #include <signal.h>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <sched.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <math.h>
 
-#define MAX_FIGHTERS 32
-#define MSG_SIZE 256
-#define OBSERVER_PATH_BASE "/tmp/battle_observer_10"
-#define MAX_OBSERVERS 10
-#define SHM_NAME "/battle_arena_10"
-#define SEM_NAME "/battle_sem_10"
+#include "gesture.h"
+#include "strategy.h"
+#include "arena.h"
+#include "watch_filter.h"
+#include "duel_message.h"
+#include "stats.h"
+#include "rating.h"
 
-typedef enum {
-    ROCK = 0,
-    SCISSORS = 1,
-    PAPER = 2
-} HandSign;
+#define RESULT_SEM_NAME "/battle_done_10"
+#define HEARTBEAT_SEC 1
+#define READY_SEM_NAME "/battle_ready_10"
+#define READY_MARK_PATH "/tmp/battle_ready_10"
+#define DEFAULT_READY_TIMEOUT_SEC 60
+#define CHECKPOINT_PATH "/tmp/battle_checkpoint_10"
+#define CHECKPOINT_MAGIC 0x31304b43
+#define WAL_CAPACITY (2 * MAX_FIGHTERS)
+#define REFEREE_FORFEIT_SEC 5
+#define PUBLISH_QUEUE_SIZE 1024
+#define FORECAST_DEFAULT_RUNS 2000000
+#define FORECAST_LANES 64
+#define FORECAST_MAX_THREADS 256
 
 typedef struct {
-    char text[MSG_SIZE];
-    int from_id;
-    int against_id;
-    int round_count;
-    int is_result;
-    HandSign move1;
-    HandSign move2;
-    int duel_rounds;
-} DuelMessage;
+    unsigned int seq;
+    int node;
+    int winner;
+    int loser;
+} OutcomeRecord;
 
 typedef struct {
-    int id;
-    int active;
-    int victories;
-    HandSign gesture;
-    int has_rival;
-    int rival_id;
-    int connected;
-} Combatant;
+    unsigned int magic;
+    unsigned int generation;
+    unsigned int seq;
+    unsigned int wal_mark[2];
+    Arena snapshots[2];
+    unsigned int wal_count;
+    OutcomeRecord wal[WAL_CAPACITY];
+} Checkpoint;
 
 typedef struct {
-    Combatant fighters[MAX_FIGHTERS];
-    int total_count;
-    int alive_count;
-    int round_num;
-    int finished;
-    int terminated;
-} Arena;
-
-Arena *combat_zone;
-int zone_fd;
-sem_t *combat_sem;
+    unsigned long long thresholds[MAX_FIGHTERS + 2][MAX_FIGHTERS + 2];
+    int bracket[2 * MAX_FIGHTERS];
+    int pending[MAX_FIGHTERS];
+    int pending_count;
+} ForecastModel;
+
+typedef struct {
+    const ForecastModel *model;
+    long long runs;
+    unsigned long long seed;
+    long long wins[MAX_FIGHTERS];
+    pthread_t thread;
+    int running;
+} ForecastWorker;
+
+typedef struct {
+    DuelMessage events[PUBLISH_QUEUE_SIZE];
+    unsigned int head __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned int sleeping;
+    unsigned int tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned int stopping;
+    unsigned int overflows;
+} PublishQueue;
+
+size_t zone_size = sizeof(Arena);
+int zone_fd = -1;
+sem_t *result_sem;
+sem_t *ready_sem;
+int match_started[MAX_FIGHTERS];
+int rounds_reported;
+Checkpoint *checkpoint;
+int logged[MAX_FIGHTERS];
+int ranked[MAX_FIGHTERS];
+int duel_rounds[MAX_FIGHTERS];
+int schedule_changed;
+time_t turn_opened;
+WatchFilter *watch_filters;
+unsigned int reported_drops[MAX_OBSERVERS];
+PublishQueue publish_queue;
+pthread_t publisher_thread;
+int publisher_running;
+int measure_holds;
+long long longest_hold_ns;
+TournamentStats *stats;
+RatingDb ratings;
+int rating_slots[MAX_FIGHTERS];
+volatile sig_atomic_t stop_signal;
 
 void create_observer_channels() {
+    shm_unlink(WATCHERS_SHM_NAME);
+    watch_filters = open_watch_filters(MAX_OBSERVERS, 1);
+    if (watch_filters == NULL) {
+        printf("Фильтры наблюдателей недоступны, наблюдатели получат все события.\n");
+    }
+
     for (int i = 0; i < MAX_OBSERVERS; i++) {
         char pipe_path[64];
         snprintf(pipe_path, sizeof(pipe_path), "%s_%d", OBSERVER_PATH_BASE, i);
@@ -68,322 +123,1464 @@ void create_observer_channels() {
     }
 }
 
-void sem_lock(sem_t *sem) {
-    int result;
-    do {
-        result = sem_wait(sem);
-    } while (result == -1 && errno == EINTR);
+void deliver_event(DuelMessage *msg, int may_wait) {
+    if (watch_filters == NULL) {
+        watch_filters = open_watch_filters(MAX_OBSERVERS, 0);
+    }
+
+    for (int i = 0; i < MAX_OBSERVERS; i++) {
+        WatchFilter *filter = watch_filters ? &watch_filters[i] : NULL;
+        if (!watcher_wants(filter, msg->kind, msg->from_id, msg->against_id)) {
+            continue;
+        }
+        char pipe_path[64];
+        snprintf(pipe_path, sizeof(pipe_path), "%s_%d", OBSERVER_PATH_BASE, i);
+        int pipe_fd = open(pipe_path, O_WRONLY | O_NONBLOCK);
+        if (pipe_fd != -1) {
+            msg->event_seq = watcher_next_seq(filter);
+            deliver_to_watcher(filter, pipe_fd, pipe_path, msg, sizeof(DuelMessage), may_wait);
+            close(pipe_fd);
+        }
+    }
 }
 
-void sem_unlock(sem_t *sem) {
-    int result;
-    do {
-        result = sem_post(sem);
-    } while (result == -1 && errno == EINTR);
+void *publisher_main(void *arg) {
+    PublishQueue *queue = arg;
+    unsigned int head = queue->head;
+
+    while (1) {
+        unsigned int tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (__atomic_load_n(&queue->stopping, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+            __atomic_store_n(&queue->sleeping, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&queue->tail, __ATOMIC_SEQ_CST) == head) {
+                struct timespec timeout = {0, 100000000};
+                futex(&queue->tail, FUTEX_WAIT, head, &timeout);
+            }
+            __atomic_store_n(&queue->sleeping, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        for (; head != tail; head++) {
+            deliver_event(&queue->events[head % PUBLISH_QUEUE_SIZE], 1);
+            __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+        }
+    }
+    return NULL;
 }
 
-void send_to_watchers(const char* message, int from_id, int against_id,
+void start_publisher() {
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    publisher_running = pthread_create(&publisher_thread, NULL, publisher_main, &publish_queue) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (!publisher_running) {
+        printf("Поток публикации не запущен, события отправляются синхронно.\n");
+    }
+}
+
+void stop_publisher() {
+    if (!publisher_running) {
+        return;
+    }
+    __atomic_store_n(&publish_queue.stopping, 1, __ATOMIC_SEQ_CST);
+    futex(&publish_queue.tail, FUTEX_WAKE, 1, NULL);
+    pthread_join(publisher_thread, NULL);
+    publisher_running = 0;
+
+    if (publish_queue.overflows > 0) {
+        printf("Очередь публикации переполнялась, потеряно событий: %u.\n", publish_queue.overflows);
+    }
+}
+
+void send_to_watchers(EventKind kind, const char* message, int from_id, int against_id, int round_count,
                       int is_result, HandSign move1, HandSign move2, int duel_rounds) {
     DuelMessage msg;
     strncpy(msg.text, message, MSG_SIZE-1);
     msg.text[MSG_SIZE-1] = '\0';
     msg.from_id = from_id;
     msg.against_id = against_id;
-    msg.round_count = combat_zone->round_num;
+    msg.round_count = round_count;
     msg.is_result = is_result;
     msg.move1 = move1;
     msg.move2 = move2;
     msg.duel_rounds = duel_rounds;
+    msg.gesture_count = combat_zone->gesture_count;
+    msg.kind = kind;
 
-    for (int i = 0; i < MAX_OBSERVERS; i++) {
-        char pipe_path[64];
-        snprintf(pipe_path, sizeof(pipe_path), "%s_%d", OBSERVER_PATH_BASE, i);
-        int pipe_fd = open(pipe_path, O_WRONLY | O_NONBLOCK);
-        if (pipe_fd != -1) {
-            ssize_t written = write(pipe_fd, &msg, sizeof(DuelMessage));
-            (void)written;
-            close(pipe_fd);
-        }
+    if (!publisher_running) {
+        deliver_event(&msg, 0);
+        return;
+    }
+
+    PublishQueue *queue = &publish_queue;
+    unsigned int tail = queue->tail;
+    if (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == PUBLISH_QUEUE_SIZE) {
+        queue->overflows++;
+        return;
+    }
+    queue->events[tail % PUBLISH_QUEUE_SIZE] = msg;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&queue->sleeping, __ATOMIC_SEQ_CST)) {
+        futex(&queue->tail, FUTEX_WAKE, 1, NULL);
     }
 }
 
 void cleanup_resources() {
+    stop_publisher();
     printf("Очистка ресурсов.\n");
     if (combat_zone) {
-        munmap(combat_zone, sizeof(Arena));
+        __atomic_store_n(&combat_zone->generation, 0, __ATOMIC_RELEASE);
+        munmap(combat_zone, zone_size);
+    }
+    if (checkpoint) {
+        munmap(checkpoint, sizeof(Checkpoint));
     }
     if (zone_fd != -1) {
         close(zone_fd);
         shm_unlink(SHM_NAME);
+        unlink(HUGE_ZONE_PATH);
     }
-    if (combat_sem != SEM_FAILED) {
-        sem_close(combat_sem);
-        sem_unlink(SEM_NAME);
+    if (result_sem != SEM_FAILED) {
+        sem_close(result_sem);
+        sem_unlink(RESULT_SEM_NAME);
     }
+    if (ready_sem != SEM_FAILED) {
+        sem_close(ready_sem);
+        sem_unlink(READY_SEM_NAME);
+    }
+    unlink(READY_MARK_PATH);
 
     for (int i = 0; i < MAX_OBSERVERS; i++) {
         char pipe_path[64];
         snprintf(pipe_path, sizeof(pipe_path), "%s_%d", OBSERVER_PATH_BASE, i);
         unlink(pipe_path);
     }
+    close_watch_filters(watch_filters, MAX_OBSERVERS);
+    shm_unlink(WATCHERS_SHM_NAME);
+    close_stats(stats);
+    shm_unlink(STATS_SHM_NAME);
+    rating_close(&ratings);
 }
 
 void signal_handler(int sig) {
-    printf("Турнир остановлен по сигналу %d.\n", sig);
-    sem_lock(combat_sem);
+    stop_signal = sig;
+}
+
+void stop_if_signalled() {
+    if (!stop_signal) {
+        return;
+    }
+    printf("Турнир остановлен по сигналу %d.\n", stop_signal);
+    arena_lock();
     combat_zone->finished = 1;
     combat_zone->terminated = 1;
-    sem_unlock(combat_sem);
-    send_to_watchers("Турнир остановлен по сигналу.", -1, -1, 0, ROCK, ROCK, 0);
+    arena_unlock();
+    send_to_watchers(EVENT_TOURNAMENT, "Турнир остановлен по сигналу.", -1, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
     sleep(1);
     cleanup_resources();
     exit(0);
 }
 
 int get_connected_count() {
-    sem_lock(combat_sem);
+    Arena view;
+    read_arena(&view);
     int count = 0;
-    for (int i = 0; i < combat_zone->total_count; i++) {
-        if (combat_zone->fighters[i].connected) {
+    for (int i = 0; i < view.total_count; i++) {
+        if (view.fighters[i].connected) {
             count++;
         }
     }
-    sem_unlock(combat_sem);
     return count;
 }
 
-void print_active_fighters() {
-    sem_lock(combat_sem);
-    printf("Промежуточные победители: ");
-    int first = 1;
-    for (int i = 0; i < combat_zone->total_count; i++) {
-        if (combat_zone->fighters[i].active) {
-            if (!first) {
+int get_watching_count() {
+    int count = 0;
+    for (int i = 0; i < MAX_OBSERVERS; i++) {
+        char pipe_path[64];
+        snprintf(pipe_path, sizeof(pipe_path), "%s_%d", OBSERVER_PATH_BASE, i);
+        int pipe_fd = open(pipe_path, O_WRONLY | O_NONBLOCK);
+        if (pipe_fd != -1) {
+            count++;
+            close(pipe_fd);
+        }
+    }
+    return count;
+}
+
+int wait_for_quorum(int fighter_quorum, int observer_quorum, const struct timespec *deadline) {
+    int last_connected = -1;
+    int last_watching = -1;
+
+    while (1) {
+        stop_if_signalled();
+        int connected = get_connected_count();
+        int watching = observer_quorum > 0 ? get_watching_count() : 0;
+
+        if (fighter_quorum > 0 && connected != last_connected) {
+            printf("Подключено %d/%d бойцов\n", connected, fighter_quorum);
+            last_connected = connected;
+        }
+        if (observer_quorum > 0 && watching != last_watching) {
+            printf("Подключено %d/%d наблюдателей\n", watching, observer_quorum);
+            last_watching = watching;
+        }
+
+        if (connected >= fighter_quorum && watching >= observer_quorum) {
+            return 1;
+        }
+
+        if (sem_timedwait(ready_sem, deadline) == -1 && errno == ETIMEDOUT) {
+            return get_connected_count() >= fighter_quorum &&
+                   (observer_quorum == 0 || get_watching_count() >= observer_quorum);
+        }
+    }
+}
+
+void build_bracket(int fighter_count) {
+    int seeds[MAX_FIGHTERS];
+    for (int i = 0; i < fighter_count; i++) {
+        seeds[i] = i;
+    }
+
+    for (int i = fighter_count - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int temp = seeds[i];
+        seeds[i] = seeds[j];
+        seeds[j] = temp;
+    }
+
+    int size = 1;
+    while (size < fighter_count) {
+        size <<= 1;
+    }
+    combat_zone->bracket_size = size;
+
+    for (int node = 1; node < size; node++) {
+        combat_zone->bracket[node] = BRACKET_PENDING;
+    }
+
+    int matches = size / 2;
+    int full_matches = fighter_count - matches;
+    int next = 0;
+    for (int k = 0; k < matches; k++) {
+        combat_zone->bracket[size + 2 * k] = seeds[next++];
+        combat_zone->bracket[size + 2 * k + 1] = k < full_matches ? seeds[next++] : BRACKET_BYE;
+    }
+}
+
+void fighter_identity(const Arena *arena, int fighter, char *name) {
+    if (arena->names[fighter][0]) {
+        snprintf(name, FIGHTER_NAME_SIZE, "%s", arena->names[fighter]);
+    } else {
+        snprintf(name, FIGHTER_NAME_SIZE, "fighter-%d", fighter);
+    }
+}
+
+int rating_slot(int fighter) {
+    if (rating_slots[fighter] == 0) {
+        char name[FIGHTER_NAME_SIZE];
+        fighter_identity(combat_zone, fighter, name);
+        rating_slots[fighter] = rating_find(&ratings, name, 1) + 1;
+    }
+    return rating_slots[fighter] - 1;
+}
+
+void seed_by_rating(int fighter_count) {
+    int seeds[MAX_FIGHTERS];
+    double seed_ratings[MAX_FIGHTERS];
+    for (int i = 0; i < fighter_count; i++) {
+        seeds[i] = i;
+    }
+    for (int i = fighter_count - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int temp = seeds[i];
+        seeds[i] = seeds[j];
+        seeds[j] = temp;
+    }
+    for (int i = 0; i < fighter_count; i++) {
+        seed_ratings[i] = rating_of(&ratings, rating_slot(seeds[i]));
+    }
+    for (int i = 1; i < fighter_count; i++) {
+        int seed = seeds[i];
+        double rating = seed_ratings[i];
+        int j = i;
+        while (j > 0 && seed_ratings[j - 1] < rating) {
+            seeds[j] = seeds[j - 1];
+            seed_ratings[j] = seed_ratings[j - 1];
+            j--;
+        }
+        seeds[j] = seed;
+        seed_ratings[j] = rating;
+    }
+
+    int size = combat_zone->bracket_size;
+    int order[MAX_FIGHTERS] = {0};
+    for (int placed = 1; placed < size; placed *= 2) {
+        for (int i = placed - 1; i >= 0; i--) {
+            order[2 * i] = order[i];
+            order[2 * i + 1] = 2 * placed - 1 - order[i];
+        }
+    }
+    for (int leaf = 0; leaf < size; leaf++) {
+        combat_zone->bracket[size + leaf] = order[leaf] < fighter_count ? seeds[order[leaf]] : BRACKET_BYE;
+    }
+
+    printf("Посев по рейтингу:");
+    for (int i = 0; i < fighter_count; i++) {
+        printf("%s Боец %d (%.0f)", i ? "," : "", seeds[i], seed_ratings[i]);
+    }
+    printf("\n");
+}
+
+int round_first_node(int round) {
+    return combat_zone->bracket_size >> round;
+}
+
+int round_decided(int round) {
+    int first = round_first_node(round);
+    for (int node = first; node < 2 * first; node++) {
+        if (combat_zone->bracket[node] == BRACKET_PENDING) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void print_round_winners(int round) {
+    int first = round_first_node(round);
+    printf("Промежуточные победители раунда %d: ", round);
+    int printed = 0;
+    for (int node = first; node < 2 * first; node++) {
+        if (combat_zone->bracket[node] >= 0) {
+            if (printed) {
                 printf(", ");
             }
-            printf("Боец %d", i);
-            first = 0;
+            printf("Боец %d", combat_zone->bracket[node]);
+            printed = 1;
         }
     }
     printf("\n");
-    sem_unlock(combat_sem);
 }
 
-void setup_round() {
-    sem_lock(combat_sem);
+void report_watchers(int summary) {
+    if (watch_filters == NULL) {
+        return;
+    }
+    for (int i = 0; i < MAX_OBSERVERS; i++) {
+        WatchFilter *filter = &watch_filters[i];
+        unsigned int dropped = __atomic_load_n(&filter->dropped, __ATOMIC_RELAXED);
+        if (summary ? __atomic_load_n(&filter->published, __ATOMIC_RELAXED) == 0 : dropped == reported_drops[i]) {
+            continue;
+        }
+        printf("Наблюдатель %d (%s): записано %u, потеряно %u, отставание %u, макс. отставание %u.\n",
+               i, watch_policy_name(filter->policy), __atomic_load_n(&filter->queued, __ATOMIC_RELAXED),
+               dropped, __atomic_load_n(&filter->lag, __ATOMIC_RELAXED),
+               __atomic_load_n(&filter->max_lag, __ATOMIC_RELAXED));
+        reported_drops[i] = dropped;
+    }
+}
+
+void start_round(int round) {
+    combat_zone->round_num = round;
+    printf("\n--- Раунд %d ---\n", round);
+    printf("Активных бойцов: %d\n", combat_zone->alive_count);
 
-    if (combat_zone->finished) {
-        sem_unlock(combat_sem);
+    char round_msg[MSG_SIZE];
+    snprintf(round_msg, MSG_SIZE, "Начало раунда %d.", round);
+    send_to_watchers(EVENT_ROUND, round_msg, -1, -1, round, 0, NO_GESTURE, NO_GESTURE, 0);
+}
+
+int open_checkpoint(int create) {
+    int fd = open(CHECKPOINT_PATH, O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0666);
+    if (fd == -1) {
+        return 0;
+    }
+
+    struct stat info;
+    if ((create && ftruncate(fd, sizeof(Checkpoint)) == -1) ||
+        fstat(fd, &info) == -1 || info.st_size < (off_t)sizeof(Checkpoint)) {
+        close(fd);
+        return 0;
+    }
+
+    checkpoint = mmap(NULL, sizeof(Checkpoint), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (checkpoint == MAP_FAILED) {
+        checkpoint = NULL;
+        return 0;
+    }
+
+    if (create) {
+        checkpoint->magic = CHECKPOINT_MAGIC;
+        checkpoint->generation = combat_zone->generation;
+    }
+    return checkpoint->magic == CHECKPOINT_MAGIC;
+}
+
+unsigned int snapshot_zone() {
+    if (!checkpoint) {
+        return 0;
+    }
+
+    unsigned int next = checkpoint->seq + 1;
+    Arena *snapshot = &checkpoint->snapshots[next & 1];
+    int copied = 0;
+    for (int attempt = 0; attempt < SEQLOCK_RETRIES && !copied; attempt++) {
+        copied = copy_between_commits(snapshot);
+        if (!copied) {
+            sched_yield();
+        }
+    }
+    if (!copied) {
+        memcpy(snapshot, combat_zone, sizeof(Arena));
+    }
+    checkpoint->wal_mark[next & 1] = checkpoint->wal_count;
+    return next;
+}
+
+void sync_checkpoint(unsigned int next) {
+    if (!checkpoint || next == 0) {
         return;
     }
 
-    int ready_fighters[MAX_FIGHTERS];
-    int count = 0;
+    msync(checkpoint, sizeof(Checkpoint), MS_SYNC);
+    __atomic_store_n(&checkpoint->seq, next, __ATOMIC_RELEASE);
+    msync(checkpoint, sizeof(Checkpoint), MS_SYNC);
+}
 
-    for (int i = 0; i < combat_zone->total_count; i++) {
-        if (combat_zone->fighters[i].active && !combat_zone->fighters[i].has_rival) {
-            ready_fighters[count++] = i;
+void save_checkpoint() {
+    sync_checkpoint(snapshot_zone());
+}
+
+void log_outcomes() {
+    if (!checkpoint) {
+        return;
+    }
+
+    for (int node = combat_zone->bracket_size - 1; node >= 1; node--) {
+        if (logged[node] || combat_zone->bracket[node] == BRACKET_PENDING) {
+            continue;
+        }
+        if (checkpoint->wal_count >= WAL_CAPACITY) {
+            return;
         }
+
+        int winner = combat_zone->bracket[node];
+        int loser = combat_zone->bracket[2 * node] == winner ?
+                    combat_zone->bracket[2 * node + 1] : combat_zone->bracket[2 * node];
+
+        OutcomeRecord *record = &checkpoint->wal[checkpoint->wal_count];
+        record->node = node;
+        record->winner = winner;
+        record->loser = loser >= 0 ? loser : -1;
+        __atomic_store_n(&record->seq, checkpoint->wal_count + 1, __ATOMIC_RELEASE);
+        checkpoint->wal_count++;
+        logged[node] = 1;
     }
+    msync(checkpoint, sizeof(Checkpoint), MS_ASYNC);
+}
 
-    for (int i = count - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        int temp = ready_fighters[i];
-        ready_fighters[i] = ready_fighters[j];
-        ready_fighters[j] = temp;
+void replay_outcomes(unsigned int from) {
+    for (unsigned int i = from; i < checkpoint->wal_count; i++) {
+        OutcomeRecord *record = &checkpoint->wal[i];
+        if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != i + 1) {
+            break;
+        }
+        if (combat_zone->bracket[record->node] != BRACKET_PENDING) {
+            continue;
+        }
+
+        combat_zone->bracket[record->node] = record->winner;
+        if (record->loser >= 0 && state_active(combat_zone->fighters[record->loser].state)) {
+            combat_zone->fighters[record->loser].state = pack_state(0, -1, -1, 0);
+            combat_zone->alive_count--;
+            combat_zone->fighters[record->winner].victories++;
+        }
+    }
+}
+
+void rank_outcomes() {
+    for (int node = 1; node < combat_zone->bracket_size; node++) {
+        int winner = combat_zone->bracket[node];
+        if (ranked[node] || winner < 0) {
+            continue;
+        }
+        ranked[node] = 1;
+        if (combat_zone->bracket[2 * node] < 0 || combat_zone->bracket[2 * node + 1] < 0) {
+            continue;
+        }
+        int loser = combat_zone->bracket[2 * node] == winner ? combat_zone->bracket[2 * node + 1] : combat_zone->bracket[2 * node];
+        rating_record(&ratings, combat_zone->tournament_id, node, rating_slot(winner), rating_slot(loser));
+    }
+}
+
+void print_leaders() {
+    RatingLeader leaders[RATING_LEADERS];
+    int count = rating_leaders(&ratings, leaders);
+    if (count == 0) {
+        return;
+    }
+    printf("Лидеры лиги по победам: ");
+    for (int i = 0; i < count; i++) {
+        printf("%s%s (%u)", i ? ", " : "", ratings.entries[leaders[i].entry].name, leaders[i].wins);
+    }
+    printf("\n");
+}
+
+void rebuild_schedule() {
+    for (int node = 1; node < combat_zone->bracket_size; node++) {
+        int fighter1 = combat_zone->bracket[2 * node];
+        int decided = combat_zone->bracket[node] != BRACKET_PENDING;
+        int running = !decided && fighter1 >= 0 && state_slot(load_state(fighter1)) == node;
+
+        match_started[node] = decided || running;
+        if (match_started[node] && slot_round(node) > combat_zone->round_num) {
+            combat_zone->round_num = slot_round(node);
+        }
+    }
+
+    if (checkpoint) {
+        for (unsigned int i = 0; i < checkpoint->wal_count; i++) {
+            if (checkpoint->wal[i].seq == i + 1) {
+                logged[checkpoint->wal[i].node] = 1;
+            }
+        }
     }
 
-    for (int i = 0; i < count - 1; i += 2) {
-        int fighter1 = ready_fighters[i];
-        int fighter2 = ready_fighters[i + 1];
+    rounds_reported = 0;
+    schedule_changed = 1;
+}
 
-        combat_zone->fighters[fighter1].has_rival = 1;
-        combat_zone->fighters[fighter1].rival_id = fighter2;
-        combat_zone->fighters[fighter2].has_rival = 1;
-        combat_zone->fighters[fighter2].rival_id = fighter1;
+int tournament_started() {
+    if (combat_zone->round_num > 0) {
+        return 1;
+    }
+    for (int node = 1; node < combat_zone->bracket_size; node++) {
+        if (match_started[node]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void engage_fighter(int fighter, int rival, int node) {
+    unsigned long long state = load_state(fighter);
+    while (state_active(state) && !change_state(fighter, state, 1, rival, node)) {
+        state = load_state(fighter);
+    }
+}
 
-        printf("Организован бой:\n Боец %d vs Боец %d\n", fighter1, fighter2);
+void finish_commits() {
+    for (int node = 1; node < combat_zone->bracket_size; node++) {
+        int winner = combat_zone->bracket[node];
+        int fighter1 = combat_zone->bracket[2 * node];
+        int fighter2 = combat_zone->bracket[2 * node + 1];
+        if (winner < 0 || fighter1 < 0 || fighter2 < 0) {
+            continue;
+        }
+        eliminate_fighter(winner == fighter1 ? fighter2 : fighter1, winner, node);
+        release_fighter(winner, node);
+    }
+}
+
+void schedule_ready_nodes() {
+    for (int node = combat_zone->bracket_size - 1; node >= 1; node--) {
+        if (match_started[node]) {
+            continue;
+        }
+
+        int fighter1 = combat_zone->bracket[2 * node];
+        int fighter2 = combat_zone->bracket[2 * node + 1];
+        if (fighter1 == BRACKET_PENDING || fighter2 == BRACKET_PENDING) {
+            continue;
+        }
+
+        int round = slot_round(node);
+        match_started[node] = 1;
+        if (round > combat_zone->round_num) {
+            start_round(round);
+        }
+
+        if (fighter1 == BRACKET_BYE || fighter2 == BRACKET_BYE) {
+            int advanced = fighter1 == BRACKET_BYE ? fighter2 : fighter1;
+            combat_zone->bracket[node] = advanced;
+            if (advanced >= 0) {
+                printf("Боец %d проходит дальше без боя.\n", advanced);
+                char message[MSG_SIZE];
+                snprintf(message, MSG_SIZE, "Боец %d проходит дальше без боя.", advanced);
+                send_to_watchers(EVENT_SCHEDULE, message, advanced, -1, round, 0, NO_GESTURE, NO_GESTURE, 0);
+            }
+            continue;
+        }
+
+        engage_fighter(fighter1, fighter2, node);
+        engage_fighter(fighter2, fighter1, node);
+        duel_rounds[node] = 0;
+        schedule_changed = 1;
+
+        printf("Организован бой (раунд %d):\n Боец %d vs Боец %d\n", round, fighter1, fighter2);
         char message[MSG_SIZE];
         snprintf(message, MSG_SIZE, "Организован бой: Боец %d vs Боец %d", fighter1, fighter2);
-        send_to_watchers(message, -1, -1, 0, ROCK, ROCK, 0);
+        send_to_watchers(EVENT_SCHEDULE, message, fighter1, fighter2, round, 0, NO_GESTURE, NO_GESTURE, 0);
     }
+}
 
-    combat_zone->round_num++;
-    printf("Начало раунда %d. Бойцов готово к бою: %d\n", combat_zone->round_num, count);
+int award_walkovers() {
+    int awarded = 0;
+    for (int node = combat_zone->bracket_size - 1; node >= 1; node--) {
+        if (!match_started[node] || combat_zone->bracket[node] != BRACKET_PENDING) {
+            continue;
+        }
 
-    char round_msg[MSG_SIZE];
-    snprintf(round_msg, MSG_SIZE, "Начало раунда %d.", combat_zone->round_num);
-    send_to_watchers(round_msg, -1, -1, 0, ROCK, ROCK, 0);
+        int fighter1 = combat_zone->bracket[2 * node];
+        int fighter2 = combat_zone->bracket[2 * node + 1];
+        if (combat_zone->fighters[fighter1].connected && combat_zone->fighters[fighter2].connected) {
+            continue;
+        }
 
-    sem_unlock(combat_sem);
+        int winner = combat_zone->fighters[fighter1].connected ? fighter1 : fighter2;
+        int loser = winner == fighter1 ? fighter2 : fighter1;
+        if (!commit_outcome(node, winner, loser)) {
+            continue;
+        }
+
+        stats_walkover(stats, slot_round(node), winner);
+        printf("Боец %d проходит дальше: Боец %d покинул турнир.\n", winner, loser);
+        char message[MSG_SIZE];
+        snprintf(message, MSG_SIZE, "Боец %d проходит дальше: Боец %d покинул турнир.", winner, loser);
+        send_to_watchers(EVENT_RESULT, message, winner, loser, slot_round(node), 0, NO_GESTURE, NO_GESTURE, 0);
+        schedule_changed = 1;
+        awarded++;
+    }
+    return awarded;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Использовано %s <количество_бойцов>.\n", argv[0]);
-        return 1;
+int duel_running(int node) {
+    int fighter1 = combat_zone->bracket[2 * node];
+    int fighter2 = combat_zone->bracket[2 * node + 1];
+    return match_started[node] && combat_zone->bracket[node] == BRACKET_PENDING &&
+           fighter1 >= 0 && fighter2 >= 0 &&
+           state_slot(load_state(fighter1)) == node && state_slot(load_state(fighter2)) == node;
+}
+
+void open_turn() {
+    unsigned int turn = combat_zone->referee_turn + 1;
+    unsigned long long needed = 0;
+    for (int node = 1; node < combat_zone->bracket_size; node++) {
+        if (duel_running(node)) {
+            needed += 2;
+        }
     }
 
-    int fighter_count = atoi(argv[1]);
-    if (fighter_count < 2 || fighter_count > MAX_FIGHTERS) {
-        printf("Количество бойцов должно быть от 2 до %d.\n", MAX_FIGHTERS);
-        return 1;
+    __atomic_store_n(&combat_zone->referee_pending, ((unsigned long long)turn << 32) | needed, __ATOMIC_RELEASE);
+    __atomic_store_n(&combat_zone->referee_turn, turn, __ATOMIC_RELEASE);
+    futex(&combat_zone->referee_turn, FUTEX_WAKE, INT_MAX, NULL);
+    turn_opened = time(NULL);
+    schedule_changed = 0;
+}
+
+void forfeit_silent_fighters() {
+    unsigned int turn = combat_zone->referee_turn;
+    for (int node = 1; node < combat_zone->bracket_size; node++) {
+        if (!duel_running(node)) {
+            continue;
+        }
+        for (int side = 0; side < 2; side++) {
+            int fighter = combat_zone->bracket[2 * node + side];
+            if (__atomic_load_n(&combat_zone->fighters[fighter].submitted_turn, __ATOMIC_ACQUIRE) != turn) {
+                combat_zone->fighters[fighter].connected = 0;
+                printf("Боец %d не сделал ход за %d секунд.\n", fighter, REFEREE_FORFEIT_SEC);
+            }
+        }
     }
+}
 
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    srand(time(NULL));
+void referee_pass() {
+    int nodes[MAX_FIGHTERS];
+    int move1[MAX_FIGHTERS];
+    int move2[MAX_FIGHTERS];
+    int outcome[MAX_FIGHTERS];
+    int count = 0;
+    int waiting = 0;
+    unsigned int turn = combat_zone->referee_turn;
+    if (turn_opened == 0) {
+        return;
+    }
 
-    printf("------ Центр управления турниром ------\n");
-    printf("Количество участников: %d.\n", fighter_count);
+    for (int node = 1; node < combat_zone->bracket_size; node++) {
+        if (!duel_running(node)) {
+            continue;
+        }
+        Combatant *fighter1 = &combat_zone->fighters[combat_zone->bracket[2 * node]];
+        Combatant *fighter2 = &combat_zone->fighters[combat_zone->bracket[2 * node + 1]];
+        if (__atomic_load_n(&fighter1->submitted_turn, __ATOMIC_ACQUIRE) != turn ||
+            __atomic_load_n(&fighter2->submitted_turn, __ATOMIC_ACQUIRE) != turn) {
+            waiting++;
+            continue;
+        }
+        nodes[count] = node;
+        move1[count] = fighter1->submitted;
+        move2[count] = fighter2->submitted;
+        count++;
+    }
+
+    for (int i = 0; i < count; i++) {
+        outcome[i] = gesture_outcome(move1[i], move2[i]);
+    }
+
+    for (int i = 0; i < count; i++) {
+        int node = nodes[i];
+        int fighter1 = combat_zone->bracket[2 * node];
+        int fighter2 = combat_zone->bracket[2 * node + 1];
+        int round = slot_round(node);
+        combat_zone->fighters[fighter1].gesture = move1[i];
+        combat_zone->fighters[fighter2].gesture = move2[i];
+        stats_exchange(stats, fighter1, move1[i], outcome[i] == 0);
+        stats_exchange(stats, fighter2, move2[i], outcome[i] == 0);
+        stats_round_exchange(stats, round, outcome[i] == 0);
+
+        if (++duel_rounds[node] == 1) {
+            char message[MSG_SIZE];
+            snprintf(message, MSG_SIZE, "Начало боя между Бойцом %d и Бойцом %d.", fighter1, fighter2);
+            send_to_watchers(EVENT_DUEL_START, message, fighter1, fighter2, round, 0, move1[i], move2[i], 0);
+        }
+
+        if (outcome[i] == 0) {
+            char message[MSG_SIZE];
+            snprintf(message, MSG_SIZE, "Ничья в бою %d vs %d (раунд %d).", fighter1, fighter2, duel_rounds[node]);
+            send_to_watchers(EVENT_DRAW, message, fighter1, fighter2, round, 0, move1[i], move2[i], duel_rounds[node]);
+            continue;
+        }
+
+        int winner = outcome[i] == 1 ? fighter1 : fighter2;
+        int loser = winner == fighter1 ? fighter2 : fighter1;
+        if (!commit_outcome(node, winner, loser)) {
+            continue;
+        }
+        stats_duel(stats, round, winner, loser, duel_rounds[node]);
+
+        char message[MSG_SIZE];
+        snprintf(message, MSG_SIZE, "Боец %d победил Бойца %d за %d раундов.", winner, loser, duel_rounds[node]);
+        send_to_watchers(EVENT_RESULT, message, fighter1, fighter2, round, 1, move1[i], move2[i], duel_rounds[node]);
+    }
+
+    if (count > 0) {
+        schedule_changed = 1;
+    } else if (waiting > 0 && time(NULL) - turn_opened >= REFEREE_FORFEIT_SEC) {
+        forfeit_silent_fighters();
+    }
+}
+
+void note_hold_time(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long held = (now.tv_sec - since->tv_sec) * 1000000000LL + (now.tv_nsec - since->tv_nsec);
+    if (held > longest_hold_ns) {
+        longest_hold_ns = held;
+    }
+}
+
+void schedule_matches() {
+    arena_lock();
+    struct timespec held_since;
+    if (measure_holds) {
+        clock_gettime(CLOCK_MONOTONIC, &held_since);
+    }
+
+    if (combat_zone->finished) {
+        arena_unlock();
+        return;
+    }
+
+    finish_commits();
+    schedule_ready_nodes();
+
+    while (award_walkovers()) {
+        schedule_ready_nodes();
+    }
+
+    if (combat_zone->referee) {
+        referee_pass();
+        schedule_ready_nodes();
+        while (award_walkovers()) {
+            schedule_ready_nodes();
+        }
+        if (schedule_changed) {
+            open_turn();
+        }
+    }
+
+    log_outcomes();
+    rank_outcomes();
+
+    int round_closed = 0;
+    while (rounds_reported < combat_zone->round_num && round_decided(rounds_reported + 1)) {
+        print_round_winners(++rounds_reported);
+        round_closed = 1;
+    }
+    unsigned int snapshot = 0;
+    if (round_closed) {
+        snapshot = snapshot_zone();
+        report_watchers(0);
+    }
+
+    if (measure_holds) {
+        note_hold_time(&held_since);
+    }
+    arena_unlock();
+    sync_checkpoint(snapshot);
+}
+
+void wait_for_result() {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += HEARTBEAT_SEC;
+
+    int result;
+    do {
+        result = sem_timedwait(result_sem, &deadline);
+    } while (result == -1 && errno == EINTR && !combat_zone->finished && !stop_signal);
+
+    __atomic_add_fetch(&combat_zone->heartbeat, 1, __ATOMIC_RELEASE);
+}
+
+size_t huge_zone_size() {
+    return (sizeof(Arena) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+int map_zone(unsigned int options) {
+    int flags = MAP_SHARED | (options & ZONE_MAP_POPULATE ? MAP_POPULATE : 0);
+    combat_zone = mmap(NULL, zone_size, PROT_READ | PROT_WRITE, flags, zone_fd, 0);
+    if (combat_zone == MAP_FAILED) {
+        combat_zone = NULL;
+        return 0;
+    }
 
-    shm_unlink(SHM_NAME);
-    sem_unlink(SEM_NAME);
+    if ((options & ZONE_MAP_THP) && madvise(combat_zone, zone_size, MADV_HUGEPAGE) == -1) {
+        perror("Прозрачные огромные страницы недоступны.");
+    }
+    if ((options & ZONE_MAP_LOCK) && mlock(combat_zone, zone_size) == -1) {
+        perror("Не удалось закрепить арену в памяти.");
+    }
+    return 1;
+}
+
+int create_zone(unsigned int *options) {
+    if (*options & ZONE_MAP_HUGETLB) {
+        zone_fd = open(HUGE_ZONE_PATH, O_CREAT | O_RDWR, 0666);
+        zone_size = huge_zone_size();
+        if (zone_fd != -1 && ftruncate(zone_fd, zone_size) == 0 && map_zone(*options)) {
+            return 1;
+        }
+        if (zone_fd != -1) {
+            close(zone_fd);
+            unlink(HUGE_ZONE_PATH);
+        }
+        printf("hugetlbfs недоступна, арена использует прозрачные огромные страницы.\n");
+        *options = (*options & ~ZONE_MAP_HUGETLB) | ZONE_MAP_THP;
+    }
 
     zone_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
     if (zone_fd == -1) {
         perror("Проблема с созданием разделяемой памяти.");
-        return 1;
+        return 0;
     }
 
-    if (ftruncate(zone_fd, sizeof(Arena)) == -1) {
+    zone_size = *options & ZONE_MAP_THP ? huge_zone_size() : sizeof(Arena);
+    if (ftruncate(zone_fd, zone_size) == -1) {
         perror("Проблема с установкой размера памяти.");
-        close(zone_fd);
-        return 1;
+        return 0;
     }
 
-    combat_zone = mmap(NULL, sizeof(Arena), PROT_READ | PROT_WRITE, MAP_SHARED, zone_fd, 0);
-    if (combat_zone == MAP_FAILED) {
+    if (!map_zone(*options)) {
         perror("Проблема с отображением памяти.");
+        return 0;
+    }
+    return 1;
+}
+
+int attach_zone() {
+    zone_fd = open(HUGE_ZONE_PATH, O_RDWR);
+    if (zone_fd == -1) {
+        zone_fd = shm_open(SHM_NAME, O_RDWR, 0666);
+    }
+    if (zone_fd == -1) {
+        return 0;
+    }
+
+    struct stat info;
+    if (fstat(zone_fd, &info) == -1 || info.st_size < (off_t)sizeof(Arena)) {
         close(zone_fd);
-        return 1;
+        zone_fd = -1;
+        return 0;
     }
 
-    memset(combat_zone, 0, sizeof(Arena));
-    combat_zone->total_count = fighter_count;
-    combat_zone->alive_count = fighter_count;
+    zone_size = info.st_size;
+    if (!map_zone(0) ||
+        __atomic_load_n(&combat_zone->generation, __ATOMIC_ACQUIRE) == 0 || combat_zone->finished) {
+        if (combat_zone) {
+            munmap(combat_zone, zone_size);
+        }
+        combat_zone = NULL;
+        close(zone_fd);
+        zone_fd = -1;
+        return 0;
+    }
 
-    for (int i = 0; i < fighter_count; i++) {
-        combat_zone->fighters[i].id = i;
-        combat_zone->fighters[i].active = 1;
-        combat_zone->fighters[i].connected = 0;
-        combat_zone->fighters[i].victories = 0;
-        combat_zone->fighters[i].gesture = ROCK;
-        combat_zone->fighters[i].has_rival = 0;
-        combat_zone->fighters[i].rival_id = -1;
-    }
-
-    combat_sem = sem_open(SEM_NAME, O_CREAT, 0666, 1);
-    if (combat_sem == SEM_FAILED) {
-        perror("Проблема с созданием семафора.");
-        cleanup_resources();
+    unsigned int options = combat_zone->map_options & (ZONE_MAP_THP | ZONE_MAP_LOCK);
+    if (options) {
+        munmap(combat_zone, zone_size);
+        if (!map_zone(options)) {
+            close(zone_fd);
+            zone_fd = -1;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int init_zone_lock() {
+    pthread_mutexattr_t lock_attr;
+    pthread_mutexattr_init(&lock_attr);
+    pthread_mutexattr_setpshared(&lock_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&lock_attr, PTHREAD_MUTEX_ROBUST);
+    int lock_result = pthread_mutex_init(&combat_zone->lock, &lock_attr);
+    pthread_mutexattr_destroy(&lock_attr);
+    if (lock_result != 0) {
+        printf("Проблема с созданием блокировки арены: %s.\n", strerror(lock_result));
+        return 0;
+    }
+    combat_zone->lock_owner = COORDINATOR_OWNER;
+    return 1;
+}
+
+int coordinator_running(pid_t pid) {
+#ifdef SYS_pidfd_open
+    int pid_fd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pid_fd != -1) {
+        struct pollfd exit_poll = {pid_fd, POLLIN, 0};
+        int running = poll(&exit_poll, 1, 0) == 0;
+        close(pid_fd);
+        return running;
+    }
+#endif
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+int restore_zone() {
+    if (!open_checkpoint(0)) {
+        return 0;
+    }
+
+    unsigned int seq = __atomic_load_n(&checkpoint->seq, __ATOMIC_ACQUIRE);
+    if (seq == 0) {
+        return 0;
+    }
+
+    *combat_zone = checkpoint->snapshots[seq & 1];
+    replay_outcomes(checkpoint->wal_mark[seq & 1]);
+    finish_commits();
+
+    combat_zone->finished = 0;
+    combat_zone->terminated = 0;
+    combat_zone->heartbeat = 0;
+    for (int i = 0; i < combat_zone->total_count; i++) {
+        int active = state_active(combat_zone->fighters[i].state);
+        combat_zone->fighters[i].connected = !active;
+        combat_zone->fighters[i].state = pack_state(active, -1, -1, 0);
+        combat_zone->fighters[i].submitted_turn = 0;
+    }
+    memset(combat_zone->mailboxes, 0, sizeof(combat_zone->mailboxes));
+    combat_zone->referee_turn = 0;
+    combat_zone->seq = 0;
+    combat_zone->commits_begun = 0;
+    combat_zone->commits_done = 0;
+    return 1;
+}
+
+unsigned long long forecast_mix(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+unsigned long long forecast_next(unsigned long long *rng) {
+    unsigned long long result = ((rng[1] * 5) << 7 | (rng[1] * 5) >> 57) * 9;
+    unsigned long long shifted = rng[1] << 17;
+    rng[2] ^= rng[0];
+    rng[3] ^= rng[1];
+    rng[1] ^= rng[2];
+    rng[0] ^= rng[3];
+    rng[2] ^= shifted;
+    rng[3] = rng[3] << 45 | rng[3] >> 19;
+    return result;
+}
+
+void *forecast_main(void *arg) {
+    ForecastWorker *worker = arg;
+    const ForecastModel *model = worker->model;
+    int slots[2 * MAX_FIGHTERS][FORECAST_LANES];
+    unsigned long long draws[FORECAST_LANES];
+    unsigned long long rng[4];
+    unsigned long long seed = worker->seed;
+    for (int i = 0; i < 4; i++) {
+        rng[i] = forecast_mix(&seed);
+    }
+    for (int node = 1; node < 2 * MAX_FIGHTERS; node++) {
+        for (int lane = 0; lane < FORECAST_LANES; lane++) {
+            slots[node][lane] = model->bracket[node];
+        }
+    }
+
+    for (long long done = 0; done < worker->runs; done += FORECAST_LANES) {
+        for (int i = 0; i < model->pending_count; i++) {
+            int node = model->pending[i];
+            const int *first = slots[2 * node];
+            const int *second = slots[2 * node + 1];
+            int *winner = slots[node];
+            for (int lane = 0; lane < FORECAST_LANES; lane++) {
+                draws[lane] = forecast_next(rng);
+            }
+            for (int lane = 0; lane < FORECAST_LANES; lane++) {
+                int a = first[lane];
+                int b = second[lane];
+                winner[lane] = draws[lane] < model->thresholds[a + 2][b + 2] ? a : b;
+            }
+        }
+
+        int lanes = worker->runs - done < FORECAST_LANES ? (int)(worker->runs - done) : FORECAST_LANES;
+        for (int lane = 0; lane < lanes; lane++) {
+            if (slots[1][lane] >= 0) {
+                worker->wins[slots[1][lane]]++;
+            }
+        }
+    }
+    return NULL;
+}
+
+unsigned long long forecast_threshold(double chance) {
+    if (chance >= 1.0) {
+        return ULLONG_MAX;
+    }
+    return chance <= 0.0 ? 0 : (unsigned long long)(chance * 18446744073709551616.0);
+}
+
+void build_forecast(ForecastModel *model, const Arena *view, const RatingDb *db) {
+    double fighter_ratings[MAX_FIGHTERS];
+    for (int i = 0; i < view->total_count; i++) {
+        char name[FIGHTER_NAME_SIZE];
+        fighter_identity(view, i, name);
+        fighter_ratings[i] = rating_of(db, db->header ? rating_find((RatingDb *)db, name, 0) : -1);
+    }
+
+    memset(model, 0, sizeof(ForecastModel));
+    for (int a = 0; a < view->total_count; a++) {
+        model->thresholds[a + 2][BRACKET_BYE + 2] = ULLONG_MAX;
+        for (int b = 0; b < view->total_count; b++) {
+            double chance = 1.0 / (1.0 + pow(10.0, (fighter_ratings[b] - fighter_ratings[a]) / 400.0));
+            if (view->fighters[a].connected != view->fighters[b].connected) {
+                chance = view->fighters[a].connected ? 1.0 : 0.0;
+            }
+            model->thresholds[a + 2][b + 2] = forecast_threshold(chance);
+        }
+    }
+
+    for (int node = 1; node < 2 * view->bracket_size; node++) {
+        model->bracket[node] = view->bracket[node];
+    }
+    for (int node = view->bracket_size - 1; node >= 1; node--) {
+        if (view->bracket[node] == BRACKET_PENDING) {
+            model->pending[model->pending_count++] = node;
+        }
+    }
+}
+
+int run_forecast(long long runs, const char *ratings_path) {
+    if (!attach_zone()) {
+        printf("Нет работающего турнира для прогноза.\n");
         return 1;
     }
+    Arena *view = malloc(sizeof(Arena));
+    read_arena(view);
+    munmap(combat_zone, zone_size);
+    close(zone_fd);
+    combat_zone = NULL;
+    zone_fd = -1;
+
+    RatingDb db;
+    if (!rating_open(&db, ratings_path, 0)) {
+        printf("База рейтингов %s недоступна, все бойцы считаются равными.\n", ratings_path);
+    }
+    ForecastModel *model = malloc(sizeof(ForecastModel));
+    build_forecast(model, view, &db);
+    rating_close(&db);
 
-    create_observer_channels();
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores < 1 ? 1 : cores > FORECAST_MAX_THREADS ? FORECAST_MAX_THREADS : (int)cores;
+    ForecastWorker *workers = calloc(threads, sizeof(ForecastWorker));
+    unsigned long long seed = (unsigned long long)time(NULL) ^ ((unsigned long long)getpid() << 32);
 
-    printf("Арена создана. Запустите процессы fighter:\n");
-    for (int i = 0; i < fighter_count; i++) {
-        printf("  ./fighter %d\n", i);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        workers[i].model = model;
+        workers[i].runs = runs / threads + (i < runs % threads);
+        workers[i].seed = forecast_mix(&seed);
+        if (pthread_create(&workers[i].thread, NULL, forecast_main, &workers[i]) != 0) {
+            forecast_main(&workers[i]);
+            continue;
+        }
+        workers[i].running = 1;
+    }
+    long long wins[MAX_FIGHTERS] = {0};
+    for (int i = 0; i < threads; i++) {
+        if (workers[i].running) {
+            pthread_join(workers[i].thread, NULL);
+        }
+        for (int f = 0; f < MAX_FIGHTERS; f++) {
+            wins[f] += workers[i].wins[f];
+        }
     }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
-    printf("\nОжидание подключения всех бойцов...\n");
-    printf("У вас есть 60 секунд, чтобы подключить игроков.\n");
-    int wait_attempts = 60;
-    int last_connected = -1;
-    
-    while (wait_attempts > 0) {
-        int connected = get_connected_count();
-        
-        if (connected != last_connected) {
-            printf("Подключено %d/%d бойцов\n", connected, fighter_count);
-            last_connected = connected;
+    int order[MAX_FIGHTERS];
+    int ranked_count = 0;
+    for (int i = 0; i < view->total_count; i++) {
+        if (wins[i] == 0) {
+            continue;
         }
-        
-        if (connected == fighter_count) {
-            printf("Все бойцы подключены!\n");
-            break;
+        int j = ranked_count++;
+        while (j > 0 && wins[order[j - 1]] < wins[i]) {
+            order[j] = order[j - 1];
+            j--;
         }
-        sleep(1);
-        wait_attempts--;
+        order[j] = i;
     }
 
-    if (get_connected_count() != fighter_count) {
-        printf("Не все бойцы подключились. Турнир отменен.\n");
-        cleanup_resources();
+    printf("Прогноз по %lld симуляциям на %d потоках за %.3f с (раунд %d, осталось бойцов: %d):\n",
+           runs, threads, elapsed, view->round_num, view->alive_count);
+    for (int i = 0; i < ranked_count; i++) {
+        int fighter = order[i];
+        double chance = (double)wins[fighter] / runs;
+        double margin = 1.96 * sqrt(chance * (1.0 - chance) / runs);
+        char name[FIGHTER_NAME_SIZE];
+        fighter_identity(view, fighter, name);
+        printf("  Боец %d (%s): %.3f%% ± %.3f%%\n", fighter, name, 100.0 * chance, 100.0 * margin);
+    }
+
+    free(workers);
+    free(model);
+    free(view);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int observer_quorum = 0;
+    int ready_timeout = DEFAULT_READY_TIMEOUT_SEC;
+    int resume = 0;
+    unsigned int map_options = 0;
+    int referee = 0;
+    int gestures = DEFAULT_GESTURES;
+    const char *ratings_path = RATING_DB_PATH;
+    int forecast = 0;
+    long long forecast_runs = FORECAST_DEFAULT_RUNS;
+    static struct option long_options[] = {
+        {"resume", no_argument, 0, 'r'},
+        {"huge-pages", no_argument, 0, 'H'},
+        {"populate", no_argument, 0, 'P'},
+        {"mlock", no_argument, 0, 'L'},
+        {"referee", no_argument, 0, 'R'},
+        {"gestures", required_argument, 0, 'g'},
+        {"ratings", required_argument, 0, 'E'},
+        {"forecast", optional_argument, 0, 'F'},
+        {"hold-times", no_argument, 0, 'T'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:t:rHPLRTg:E:F::", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'o': observer_quorum = atoi(optarg); break;
+            case 't': ready_timeout = atoi(optarg); break;
+            case 'r': resume = 1; break;
+            case 'H': map_options |= ZONE_MAP_HUGETLB; break;
+            case 'P': map_options |= ZONE_MAP_POPULATE; break;
+            case 'L': map_options |= ZONE_MAP_LOCK; break;
+            case 'R': referee = 1; break;
+            case 'T': measure_holds = 1; break;
+            case 'g': gestures = gesture_count_for(optarg); break;
+            case 'E': ratings_path = optarg; break;
+            case 'F':
+                forecast = 1;
+                if (optarg) {
+                    forecast_runs = atoll(optarg);
+                }
+                break;
+            default:
+                printf("Использовано %s [-o наблюдатели] [-t секунды] [-H] [-P] [-L] [-R] [-T] [-g жесты] [-E рейтинги] [--forecast[=N]] [--resume] <количество_бойцов>.\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (forecast) {
+        if (forecast_runs < 1 || optind != argc) {
+            printf("Использовано %s --forecast[=симуляции] [-E рейтинги].\n", argv[0]);
+            return 1;
+        }
+        return run_forecast(forecast_runs, ratings_path);
+    }
+
+    if (optind != argc - 1 && !(resume && optind == argc)) {
+        printf("Использовано %s [-o наблюдатели] [-t секунды] [-H] [-P] [-L] [-R] [-T] [-g жесты] [-E рейтинги] [--forecast[=N]] [--resume] <количество_бойцов>.\n", argv[0]);
         return 1;
     }
 
-    printf("\nЗапуск наблюдателей:\n");
-    printf("Теперь у вас есть 40 секунд чтобы запустить наблюдателей.\n");
-    send_to_watchers("Турнир начал работу.", -1, -1, 0, ROCK, ROCK, 0);
-    sleep(40);
+    int fighter_count = optind < argc ? atoi(argv[optind]) : 0;
+    if (!resume && (fighter_count < 2 || fighter_count > MAX_FIGHTERS)) {
+        printf("Количество бойцов должно быть от 2 до %d.\n", MAX_FIGHTERS);
+        return 1;
+    }
 
-    printf("\n------ Турнир начинается! ------\n");
-    send_to_watchers("Турнир начинается!", -1, -1, 0, ROCK, ROCK, 0);
-    sleep(2);
+    if (!gesture_init(gestures)) {
+        printf("Набор жестов: rps, rpsls, rps101 или нечетное число от 3 до %d.\n", MAX_GESTURES);
+        return 1;
+    }
 
-    int round = 0;
-    while (!combat_zone->finished) {
-        sem_lock(combat_sem);
-        int active = combat_zone->alive_count;
-        sem_unlock(combat_sem);
+    if (observer_quorum < 0 || observer_quorum > MAX_OBSERVERS || ready_timeout < 1) {
+        printf("Наблюдателей должно быть от 0 до %d, таймаут не меньше 1 секунды.\n", MAX_OBSERVERS);
+        return 1;
+    }
 
-        if (active <= 1) {
-            sem_lock(combat_sem);
-            combat_zone->finished = 1;
-            sem_unlock(combat_sem);
-            break;
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    srand(time(NULL));
+
+    printf("------ Центр управления турниром ------\n");
+
+    int attached = resume && attach_zone();
+    if (attached) {
+        pid_t previous = combat_zone->coordinator_pid;
+        if (previous != getpid() && coordinator_running(previous)) {
+            printf("Турнир уже ведет координатор %d.\n", previous);
+            munmap(combat_zone, zone_size);
+            close(zone_fd);
+            return 1;
         }
 
-        printf("\n--- Раунд %d ---\n", ++round);
-        printf("Активных бойцов: %d\n", active);
+        arena_lock();
+        __atomic_store_n(&combat_zone->coordinator_pid, getpid(), __ATOMIC_RELEASE);
+        __atomic_add_fetch(&combat_zone->heartbeat, 1, __ATOMIC_RELEASE);
+        arena_unlock();
+
+        if (!open_checkpoint(0) || checkpoint->generation != combat_zone->generation) {
+            if (checkpoint) {
+                munmap(checkpoint, sizeof(Checkpoint));
+                checkpoint = NULL;
+            }
+            open_checkpoint(1);
+        }
+        fighter_count = combat_zone->total_count;
+        printf("Подключение к работающей арене, раунд %d, осталось бойцов: %d.\n",
+               combat_zone->round_num, combat_zone->alive_count);
+    } else {
+        shm_unlink(SHM_NAME);
+        unlink(HUGE_ZONE_PATH);
+        sem_unlink(RESULT_SEM_NAME);
+        sem_unlink(READY_SEM_NAME);
+        unlink(READY_MARK_PATH);
 
-        setup_round();
-        sleep(3);
+        if (!create_zone(&map_options)) {
+            cleanup_resources();
+            return 1;
+        }
+        memset(combat_zone, 0, sizeof(Arena));
 
-        int duels_active;
-        int max_waits = 30;
-        do {
-            duels_active = 0;
-            sem_lock(combat_sem);
+        if (resume) {
+            if (!restore_zone()) {
+                printf("Нет ни работающей арены, ни контрольной точки для продолжения.\n");
+                cleanup_resources();
+                return 1;
+            }
+            fighter_count = combat_zone->total_count;
+            printf("Турнир восстановлен из контрольной точки, раунд %d, осталось бойцов: %d.\n",
+                   combat_zone->round_num, combat_zone->alive_count);
+        } else {
+            combat_zone->total_count = fighter_count;
+            combat_zone->alive_count = fighter_count;
             for (int i = 0; i < fighter_count; i++) {
-                if (combat_zone->fighters[i].has_rival) {
-                    duels_active = 1;
-                    break;
-                }
+                combat_zone->fighters[i].state = pack_state(1, -1, -1, 0);
+                combat_zone->fighters[i].connected = 0;
+                combat_zone->fighters[i].victories = 0;
+                combat_zone->fighters[i].gesture = NO_GESTURE;
             }
-            sem_unlock(combat_sem);
-            if (duels_active) {
-                sleep(1);
-                max_waits--;
+            build_bracket(fighter_count);
+        }
+        combat_zone->generation = ((unsigned int)time(NULL) ^ (unsigned int)getpid()) | 1;
+        combat_zone->coordinator_pid = getpid();
+        combat_zone->map_options = map_options;
+        if (!resume) {
+            combat_zone->tournament_id = combat_zone->generation;
+        }
+        if (referee) {
+            combat_zone->referee = 1;
+        }
+        if (!resume) {
+            combat_zone->gesture_count = gestures;
+        }
+
+        if (!init_zone_lock()) {
+            cleanup_resources();
+            return 1;
+        }
+
+        if (checkpoint) {
+            munmap(checkpoint, sizeof(Checkpoint));
+            checkpoint = NULL;
+        }
+        if (!open_checkpoint(1)) {
+            printf("Контрольная точка недоступна, турнир идет без нее.\n");
+        }
+        save_checkpoint();
+    }
+    printf("Количество участников: %d.\n", fighter_count);
+    if (!gesture_init(combat_zone->gesture_count)) {
+        printf("Неизвестный набор жестов арены.\n");
+        cleanup_resources();
+        return 1;
+    }
+    printf("Жестов в игре: %d.\n", gesture_count());
+
+    stats = open_stats(1, !resume);
+    if (stats == NULL) {
+        printf("Статистика бойцов недоступна, турнир идет без нее.\n");
+    } else {
+        stats->total_count = fighter_count;
+        stats->gesture_count = gesture_count();
+    }
+
+    if (!rating_open(&ratings, ratings_path, 1)) {
+        printf("База рейтингов %s недоступна, посев случайный.\n", ratings_path);
+    }
+
+    result_sem = sem_open(RESULT_SEM_NAME, O_CREAT, 0666, 0);
+    if (result_sem == SEM_FAILED) {
+        perror("Проблема с созданием семафора результатов.");
+        cleanup_resources();
+        return 1;
+    }
+
+    ready_sem = sem_open(READY_SEM_NAME, O_CREAT, 0666, 0);
+    if (ready_sem == SEM_FAILED) {
+        perror("Проблема с созданием семафора готовности.");
+        cleanup_resources();
+        return 1;
+    }
+    int ready_mark = open(READY_MARK_PATH, O_CREAT | O_WRONLY, 0666);
+    if (ready_mark != -1) {
+        close(ready_mark);
+    }
+
+    arena_lock();
+    rebuild_schedule();
+    int started = tournament_started();
+    arena_unlock();
+    start_publisher();
+
+    if ((!attached || !started) && combat_zone->bracket[1] == BRACKET_PENDING) {
+        if (!attached) {
+            create_observer_channels();
+        }
+
+        printf("Арена создана. Запустите процессы fighter:\n");
+        for (int i = 0; i < fighter_count; i++) {
+            if (!combat_zone->fighters[i].connected) {
+                printf("  ./fighter %d\n", i);
             }
-        } while (duels_active && max_waits > 0);
+        }
+
+        printf("\nОжидание подключения всех бойцов...\n");
+        printf("У вас есть %d секунд, чтобы подключить игроков", ready_timeout);
+        if (observer_quorum > 0) {
+            printf(" и %d наблюдателей", observer_quorum);
+        }
+        printf(".\n");
+        send_to_watchers(EVENT_TOURNAMENT, "Турнир начал работу.", -1, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
+
+        struct timespec ready_deadline;
+        clock_gettime(CLOCK_REALTIME, &ready_deadline);
+        ready_deadline.tv_sec += ready_timeout;
 
-        print_active_fighters();
+        if (!wait_for_quorum(fighter_count, 0, &ready_deadline)) {
+            printf("Не все бойцы подключились. Турнир отменен.\n");
+            cleanup_resources();
+            return 1;
+        }
+        printf("Все бойцы подключены!\n");
+        if (!started && ratings.header) {
+            arena_lock();
+            seed_by_rating(fighter_count);
+            unsigned int snapshot = snapshot_zone();
+            arena_unlock();
+            sync_checkpoint(snapshot);
+        }
+
+        if (observer_quorum > 0 && !wait_for_quorum(0, observer_quorum, &ready_deadline)) {
+            printf("Не все наблюдатели подключились, турнир начинается без них.\n");
+        }
+
+        printf("\n------ Турнир начинается! ------\n");
+        send_to_watchers(EVENT_TOURNAMENT, "Турнир начинается!", -1, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
+    } else {
+        send_to_watchers(EVENT_TOURNAMENT, "Турнир продолжается.", -1, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
     }
 
-    sem_lock(combat_sem);
-    int winner_found = 0;
-    for (int i = 0; i < fighter_count; i++) {
-        if (combat_zone->fighters[i].active) {
-            printf("\nТурнир завершен! Победитель: Боец %d\n", i);
-            char winner_msg[MSG_SIZE];
-            snprintf(winner_msg, MSG_SIZE, "Турнир завершен! Победитель: Боец %d", i);
-            send_to_watchers(winner_msg, -1, -1, 0, ROCK, ROCK, 0);
-            winner_found = 1;
-            break;
+    while (!combat_zone->finished) {
+        stop_if_signalled();
+        schedule_matches();
+
+        arena_lock();
+        int active = __atomic_load_n(&combat_zone->alive_count, __ATOMIC_ACQUIRE);
+        int decided = combat_zone->bracket[1] != BRACKET_PENDING;
+        if (active <= 1 || decided) {
+            combat_zone->finished = 1;
+        }
+        arena_unlock();
+
+        if (!combat_zone->finished) {
+            wait_for_result();
         }
     }
-    
-    if (!winner_found) {
+
+    arena_lock();
+    int winner = combat_zone->bracket[1];
+    if (winner >= 0) {
+        printf("\nТурнир завершен! Победитель: Боец %d\n", winner);
+        char winner_msg[MSG_SIZE];
+        snprintf(winner_msg, MSG_SIZE, "Турнир завершен! Победитель: Боец %d", winner);
+        send_to_watchers(EVENT_TOURNAMENT, winner_msg, -1, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
+    } else {
         printf("\nТурнир завершен! Победитель не определен.\n");
-        send_to_watchers("Турнир завершен! Победитель не определен.", -1, -1, 0, ROCK, ROCK, 0);
+        send_to_watchers(EVENT_TOURNAMENT, "Турнир завершен! Победитель не определен.", -1, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
     }
-    sem_unlock(combat_sem);
+    arena_unlock();
 
+    print_leaders();
     printf("Все бои завершены.\n");
-    send_to_watchers("Все бои завершены.", -1, -1, 0, ROCK, ROCK, 0);
+    send_to_watchers(EVENT_TOURNAMENT, "Все бои завершены.", -1, -1, combat_zone->round_num, 0, NO_GESTURE, NO_GESTURE, 0);
+    stop_publisher();
+    report_watchers(1);
+    if (measure_holds) {
+        printf("Самое долгое планирование под блокировкой арены: %.1f мкс.\n", longest_hold_ns / 1000.0);
+    }
+    unlink(CHECKPOINT_PATH);
     sleep(2);
     cleanup_resources();
     return 0;
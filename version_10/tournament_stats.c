@@ -0,0 +1,164 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "gesture.h"
+#include "stats.h"
+#include "rating.h"
+
+const TournamentStats *stats;
+
+const TournamentStats *map_stats() {
+    int fd = shm_open(STATS_SHM_NAME, O_RDONLY, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+    const TournamentStats *mapped = mmap(NULL, sizeof(TournamentStats), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return mapped == MAP_FAILED ? NULL : mapped;
+}
+
+int stats_present() {
+    int fd = shm_open(STATS_SHM_NAME, O_RDONLY, 0);
+    if (fd == -1) {
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+double ratio(unsigned long long part, unsigned long long whole) {
+    return whole ? (double)part / whole : 0.0;
+}
+
+void print_fighter(int fighter) {
+    const FighterStats *entry = &stats->fighters[fighter];
+    unsigned long long duels = stats_load(&entry->duels);
+    unsigned long long exchanges = stats_load(&entry->exchanges);
+    unsigned long long draws = stats_load(&entry->draws);
+    unsigned long long moves = 0;
+    for (int g = 0; g < gesture_count(); g++) {
+        moves += stats_load(&entry->gestures[g]);
+    }
+
+    printf("Боец %d\n", fighter);
+    printf("  Боев: %llu, побед: %llu, поражений: %llu, без боя: %llu\n", duels,
+           stats_load(&entry->wins), stats_load(&entry->losses), stats_load(&entry->walkovers));
+    printf("  Раундов в среднем за бой: %.2f\n", ratio(exchanges, duels));
+    printf("  Доля ничьих: %.1f%% (%llu из %llu ходов)\n", 100.0 * ratio(draws, moves), draws, moves);
+    printf("  Жесты:\n");
+    for (int g = 0; g < gesture_count(); g++) {
+        unsigned long long played = stats_load(&entry->gestures[g]);
+        if (played) {
+            printf("    %-16s %8llu  %5.1f%%\n", gesture_name(g), played, 100.0 * ratio(played, moves));
+        }
+    }
+}
+
+void print_summary() {
+    printf("Боец     Боев  Побед  Пораж   Б/боя  Раунд/бой   Ничьи,%%\n");
+    for (int i = 0; i < stats->total_count && i < STATS_MAX_FIGHTERS; i++) {
+        const FighterStats *entry = &stats->fighters[i];
+        unsigned long long duels = stats_load(&entry->duels);
+        unsigned long long moves = 0;
+        for (int g = 0; g < gesture_count(); g++) {
+            moves += stats_load(&entry->gestures[g]);
+        }
+        printf("%-6d %6llu %6llu %6llu %7llu %10.2f %9.1f\n", i, duels, stats_load(&entry->wins),
+               stats_load(&entry->losses), stats_load(&entry->walkovers),
+               ratio(stats_load(&entry->exchanges), duels), 100.0 * ratio(stats_load(&entry->draws), moves));
+    }
+
+    printf("\nРаунд    Боев   Б/боя  Раунд/бой   Ничьи,%%\n");
+    for (int round = 1; round < STATS_MAX_ROUNDS; round++) {
+        const RoundStats *entry = &stats->rounds[round];
+        unsigned long long duels = stats_load(&entry->duels);
+        unsigned long long walkovers = stats_load(&entry->walkovers);
+        if (duels == 0 && walkovers == 0) {
+            continue;
+        }
+        unsigned long long exchanges = stats_load(&entry->exchanges);
+        printf("%-6d %6llu %7llu %10.2f %9.1f\n", round, duels, walkovers, ratio(exchanges, duels),
+               100.0 * ratio(stats_load(&entry->draws), exchanges));
+    }
+}
+
+void print_leaders(const RatingDb *ratings) {
+    RatingLeader leaders[RATING_LEADERS];
+    int count = rating_leaders(ratings, leaders);
+    printf("Место  Победы  Боец\n");
+    for (int i = 0; i < count; i++) {
+        printf("%-6d %6u  %s\n", i + 1, leaders[i].wins, ratings->entries[leaders[i].entry].name);
+    }
+}
+
+int watch_leaders(const char *ratings_path, int interval) {
+    RatingDb ratings;
+    if (!rating_open(&ratings, ratings_path, 0)) {
+        printf("База рейтингов %s недоступна.\n", ratings_path);
+        return 1;
+    }
+    do {
+        print_leaders(&ratings);
+        if (interval > 0) {
+            printf("\n");
+            fflush(stdout);
+            sleep(interval);
+        }
+    } while (interval > 0);
+    rating_close(&ratings);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int interval = 0;
+    int leaders_only = 0;
+    const char *ratings_path = RATING_DB_PATH;
+    int option;
+    while ((option = getopt(argc, argv, "i:tE:")) != -1) {
+        switch (option) {
+            case 'i': interval = atoi(optarg); break;
+            case 't': leaders_only = 1; break;
+            case 'E': ratings_path = optarg; break;
+            default:
+                printf("Использовано %s [-i секунды] [-t [-E рейтинги]] [ID_бойца]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (leaders_only) {
+        return watch_leaders(ratings_path, interval);
+    }
+    int fighter = optind < argc ? atoi(argv[optind]) : -1;
+
+    stats = map_stats();
+    if (stats == NULL) {
+        printf("Статистика турнира недоступна: турнир не запущен.\n");
+        return 1;
+    }
+    if (fighter >= stats->total_count || fighter >= STATS_MAX_FIGHTERS) {
+        printf("Бойца %d нет в турнире.\n", fighter);
+        return 1;
+    }
+    if (!gesture_init(stats->gesture_count)) {
+        printf("Неизвестный набор жестов в статистике.\n");
+        return 1;
+    }
+
+    do {
+        if (fighter >= 0) {
+            print_fighter(fighter);
+        } else {
+            print_summary();
+        }
+        if (interval > 0) {
+            printf("\n");
+            fflush(stdout);
+            sleep(interval);
+        }
+    } while (interval > 0 && stats_present());
+
+    munmap((void *)stats, sizeof(TournamentStats));
+    return 0;
+}
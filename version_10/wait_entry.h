@@ -0,0 +1,6 @@
+#ifndef WAIT_ENTRY_H
+#define WAIT_ENTRY_H
+
+int wait_for_entry(const char *path, int timeout_sec);
+
+#endif
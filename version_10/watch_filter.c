@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "watch_filter.h"
+
+const struct {
+    const char *name;
+    EventKind kind;
+} event_names[] = {
+    {"tournament", EVENT_TOURNAMENT},
+    {"round", EVENT_ROUND},
+    {"schedule", EVENT_SCHEDULE},
+    {"start", EVENT_DUEL_START},
+    {"draw", EVENT_DRAW},
+    {"result", EVENT_RESULT},
+    {"fighter", EVENT_FIGHTER}
+};
+
+#define EVENT_NAMES (int)(sizeof(event_names) / sizeof(event_names[0]))
+
+const char *policy_names[WATCH_POLICIES] = {"drop-newest", "drop-oldest", "coalesce", "block"};
+
+unsigned int event_kinds_for(const char *list) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%s", list);
+
+    unsigned int kinds = 0;
+    char *saved;
+    for (char *name = strtok_r(buffer, ",", &saved); name; name = strtok_r(NULL, ",", &saved)) {
+        unsigned int kind = 0;
+        for (int i = 0; i < EVENT_NAMES; i++) {
+            if (strcmp(event_names[i].name, name) == 0) {
+                kind = event_names[i].kind;
+            }
+        }
+        if (kind == 0) {
+            return 0;
+        }
+        kinds |= kind;
+    }
+    return kinds;
+}
+
+int watch_policy_for(const char *name) {
+    for (int policy = 0; policy < WATCH_POLICIES; policy++) {
+        if (strcmp(policy_names[policy], name) == 0) {
+            return policy;
+        }
+    }
+    return -1;
+}
+
+const char *watch_policy_name(unsigned int policy) {
+    return policy < WATCH_POLICIES ? policy_names[policy] : "unknown";
+}
+
+WatchFilter *open_watch_filters(int count, int create) {
+    size_t size = count * sizeof(WatchFilter);
+    int fd = shm_open(WATCHERS_SHM_NAME, create ? O_CREAT | O_RDWR : O_RDWR, 0666);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (create && ftruncate(fd, size) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    WatchFilter *filters = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return filters == MAP_FAILED ? NULL : filters;
+}
+
+void close_watch_filters(WatchFilter *filters, int count) {
+    if (filters) {
+        munmap(filters, count * sizeof(WatchFilter));
+    }
+}
+
+int watcher_wants(WatchFilter *filter, EventKind kind, int from_id, int against_id) {
+    if (filter == NULL || !__atomic_load_n(&filter->active, __ATOMIC_ACQUIRE) || kind == EVENT_TOURNAMENT) {
+        return 1;
+    }
+    if (!(filter->kinds & kind)) {
+        return 0;
+    }
+
+    unsigned int fighters = filter->fighters;
+    if (fighters && (from_id >= 0 || against_id >= 0)) {
+        int named = (from_id >= 0 && (fighters >> from_id & 1)) ||
+                    (against_id >= 0 && (fighters >> against_id & 1));
+        if (!named) {
+            return 0;
+        }
+    }
+
+    if (kind == EVENT_DRAW && filter->draw_sample > 1) {
+        return __atomic_fetch_add(&filter->draw_counter, 1, __ATOMIC_RELAXED) % filter->draw_sample == 0;
+    }
+    return 1;
+}
+
+unsigned int watcher_next_seq(WatchFilter *filter) {
+    if (filter == NULL || !__atomic_load_n(&filter->active, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    return __atomic_add_fetch(&filter->published, 1, __ATOMIC_RELAXED);
+}
+
+int discard_queued(const char *pipe_path, int limit, size_t size) {
+    int reader = open(pipe_path, O_RDONLY | O_NONBLOCK);
+    if (reader == -1) {
+        return 0;
+    }
+
+    char message[PIPE_BUF];
+    int discarded = 0;
+    while (discarded < limit && read(reader, message, size) == (ssize_t)size) {
+        discarded++;
+    }
+    close(reader);
+    return discarded;
+}
+
+int wait_writable(int pipe_fd, unsigned int block_ms) {
+    struct pollfd pipe_poll = {pipe_fd, POLLOUT, 0};
+    int timeout = block_ms < WATCH_BLOCK_MAX_MS ? (int)block_ms : WATCH_BLOCK_MAX_MS;
+    int ready;
+    do {
+        ready = poll(&pipe_poll, 1, timeout);
+    } while (ready == -1 && errno == EINTR);
+    return ready == 1 && (pipe_poll.revents & POLLOUT);
+}
+
+int deliver_to_watcher(WatchFilter *filter, int pipe_fd, const char *pipe_path, const void *message, size_t size,
+                       int may_wait) {
+    int active = filter && __atomic_load_n(&filter->active, __ATOMIC_ACQUIRE);
+    unsigned int policy = active ? filter->policy : WATCH_DROP_NEWEST;
+    unsigned int dropped = 0;
+
+    ssize_t written = write(pipe_fd, message, size);
+    if (written == -1 && errno == EAGAIN && may_wait) {
+        if (policy == WATCH_DROP_OLDEST) {
+            dropped += discard_queued(pipe_path, 1, size);
+            written = write(pipe_fd, message, size);
+        } else if (policy == WATCH_COALESCE) {
+            dropped += discard_queued(pipe_path, INT_MAX, size);
+            written = write(pipe_fd, message, size);
+        } else if (policy == WATCH_BLOCK && !__atomic_load_n(&filter->stalled, __ATOMIC_RELAXED)) {
+            if (wait_writable(pipe_fd, filter->block_ms)) {
+                written = write(pipe_fd, message, size);
+            }
+            __atomic_store_n(&filter->stalled, written != (ssize_t)size, __ATOMIC_RELAXED);
+        }
+    } else if (active && written == (ssize_t)size) {
+        __atomic_store_n(&filter->stalled, 0, __ATOMIC_RELAXED);
+    }
+    int delivered = written == (ssize_t)size;
+    dropped += !delivered;
+
+    if (active) {
+        int pending = 0;
+        if (ioctl(pipe_fd, FIONREAD, &pending) == 0) {
+            unsigned int lag = pending / size;
+            unsigned int max_lag = __atomic_load_n(&filter->max_lag, __ATOMIC_RELAXED);
+            __atomic_store_n(&filter->lag, lag, __ATOMIC_RELAXED);
+            while (lag > max_lag &&
+                   !__atomic_compare_exchange_n(&filter->max_lag, &max_lag, lag, 0,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            }
+        }
+        __atomic_add_fetch(&filter->queued, delivered, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&filter->dropped, dropped, __ATOMIC_RELAXED);
+    }
+    return delivered;
+}
@@ -0,0 +1,55 @@
+#ifndef WATCH_FILTER_H
+#define WATCH_FILTER_H
+
+#include <stddef.h>
+
+#define WATCHERS_SHM_NAME "/battle_watchers_10"
+#define WATCH_BLOCK_DEFAULT_MS 20
+#define WATCH_BLOCK_MAX_MS 100
+
+typedef enum {
+    EVENT_TOURNAMENT = 1,
+    EVENT_ROUND = 2,
+    EVENT_SCHEDULE = 4,
+    EVENT_DUEL_START = 8,
+    EVENT_DRAW = 16,
+    EVENT_RESULT = 32,
+    EVENT_FIGHTER = 64,
+    EVENT_ALL = 127
+} EventKind;
+
+typedef enum {
+    WATCH_DROP_NEWEST,
+    WATCH_DROP_OLDEST,
+    WATCH_COALESCE,
+    WATCH_BLOCK,
+    WATCH_POLICIES
+} WatchPolicy;
+
+typedef struct {
+    unsigned int active;
+    unsigned int kinds;
+    unsigned int fighters;
+    unsigned int draw_sample;
+    unsigned int draw_counter;
+    unsigned int policy;
+    unsigned int block_ms;
+    unsigned int published;
+    unsigned int queued;
+    unsigned int dropped;
+    unsigned int lag;
+    unsigned int max_lag;
+    unsigned int stalled;
+} __attribute__((aligned(64))) WatchFilter;
+
+unsigned int event_kinds_for(const char *list);
+int watch_policy_for(const char *name);
+const char *watch_policy_name(unsigned int policy);
+WatchFilter *open_watch_filters(int count, int create);
+void close_watch_filters(WatchFilter *filters, int count);
+int watcher_wants(WatchFilter *filter, EventKind kind, int from_id, int against_id);
+unsigned int watcher_next_seq(WatchFilter *filter);
+int deliver_to_watcher(WatchFilter *filter, int pipe_fd, const char *pipe_path, const void *message, size_t size,
+                       int may_wait);
+
+#endif
@@ -0,0 +1,28 @@
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "futex_lock.h"
+
+long futex(uint32_t *word, int op, uint32_t value, const struct timespec *timeout) {
+    return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
+
+void arena_lock(uint32_t *lock) {
+    uint32_t expected;
+    for (int spin = 0; spin < LOCK_SPINS; spin++) {
+        expected = 0;
+        if (__atomic_compare_exchange_n(lock, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+    while (__atomic_exchange_n(lock, 2, __ATOMIC_ACQUIRE) != 0) {
+        futex(lock, FUTEX_WAIT, 2, NULL);
+    }
+}
+
+void arena_unlock(uint32_t *lock) {
+    if (__atomic_exchange_n(lock, 0, __ATOMIC_RELEASE) == 2) {
+        futex(lock, FUTEX_WAKE, 1, NULL);
+    }
+}
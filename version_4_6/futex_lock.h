@@ -0,0 +1,13 @@
+#ifndef FUTEX_LOCK_H
+#define FUTEX_LOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define LOCK_SPINS 100
+
+long futex(uint32_t *word, int op, uint32_t value, const struct timespec *timeout);
+void arena_lock(uint32_t *lock);
+void arena_unlock(uint32_t *lock);
+
+#endif
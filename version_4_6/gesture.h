@@ -0,0 +1,20 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#define MAX_GESTURES 101
+#define GESTURE_WORDS ((MAX_GESTURES + 63) / 64)
+#define DEFAULT_GESTURES 3
+#define NO_GESTURE 0
+
+typedef int HandSign;
+
+int gesture_count_for(const char *set_name);
+int gesture_init(int count);
+int gesture_count();
+int gesture_beats(HandSign sign1, HandSign sign2);
+int gesture_outcome(HandSign sign1, HandSign sign2);
+HandSign get_winner(HandSign sign1, HandSign sign2);
+HandSign gesture_counter(HandSign sign);
+const char *gesture_name(HandSign sign);
+
+#endif
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <semaphore.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <stdint.h>
+
+#include "futex_lock.h"
+
+#define BENCH_SEM_NAME "/tournament_bench_sem_46"
+#define DEFAULT_PROCESSES 2
+#define DEFAULT_ITERATIONS 200000
+#define CRITICAL_WORK 32
+
+typedef struct {
+    uint32_t lock;
+    long counter;
+    int scratch[CRITICAL_WORK];
+} BenchZone;
+
+BenchZone *zone;
+sem_t *bench_sem;
+
+void sem_lock(sem_t *sem) {
+    int result;
+    do {
+        result = sem_wait(sem);
+    } while (result == -1 && errno == EINTR);
+}
+
+void sem_unlock(sem_t *sem) {
+    int result;
+    do {
+        result = sem_post(sem);
+    } while (result == -1 && errno == EINTR);
+}
+
+void critical_section() {
+    zone->counter++;
+    for (int i = 0; i < CRITICAL_WORK; i++) {
+        zone->scratch[i] += i;
+    }
+}
+
+void run_worker(int use_futex, int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        if (use_futex) {
+            arena_lock(&zone->lock);
+            critical_section();
+            arena_unlock(&zone->lock);
+        } else {
+            sem_lock(bench_sem);
+            critical_section();
+            sem_unlock(bench_sem);
+        }
+    }
+}
+
+double run_bench(int use_futex, int processes, int iterations) {
+    memset(zone, 0, sizeof(BenchZone));
+    fflush(stdout);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int p = 0; p < processes; p++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_worker(use_futex, iterations);
+            exit(0);
+        } else if (pid < 0) {
+            perror("Проблема с созданием процесса.");
+            exit(1);
+        }
+    }
+    for (int p = 0; p < processes; p++) {
+        wait(NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long expected = (long)processes * iterations;
+    if (zone->counter != expected) {
+        printf("Ошибка: счетчик %ld, ожидалось %ld.\n", zone->counter, expected);
+    }
+
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return elapsed_ns / expected;
+}
+
+int main(int argc, char *argv[]) {
+    int processes = argc > 1 ? atoi(argv[1]) : DEFAULT_PROCESSES;
+    int iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+    if (processes < 1 || iterations < 1) {
+        printf("Использовано %s [процессы] [итерации].\n", argv[0]);
+        return 1;
+    }
+
+    zone = mmap(NULL, sizeof(BenchZone), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (zone == MAP_FAILED) {
+        perror("Проблема с отображением памяти.");
+        return 1;
+    }
+
+    sem_unlink(BENCH_SEM_NAME);
+    bench_sem = sem_open(BENCH_SEM_NAME, O_CREAT, 0666, 1);
+    if (bench_sem == SEM_FAILED) {
+        perror("Проблема с созданием семафора.");
+        munmap(zone, sizeof(BenchZone));
+        return 1;
+    }
+
+    printf("Процессов: %d, захватов на процесс: %d.\n", processes, iterations);
+    printf("futex в общей памяти:  %.1f нс/захват\n", run_bench(1, processes, iterations));
+    printf("именованный семафор:   %.1f нс/захват\n", run_bench(0, processes, iterations));
+
+    sem_close(bench_sem);
+    sem_unlink(BENCH_SEM_NAME);
+    munmap(zone, sizeof(BenchZone));
+    return 0;
+}
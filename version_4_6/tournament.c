@@ -3,23 +3,21 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/wait.h>
-#include <semaphore.h>
 #include <signal.h>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <linux/futex.h>
+#include <stdint.h>
+
+#include "gesture.h"
+#include "futex_lock.h"
 
 #define MAX_FIGHTERS 32
 #define SHM_NAME "/tournament_shm_46"
-#define SEM_NAME "/tournament_sem_46"
-
-typedef enum {
-    ROCK = 0,
-    SCISSORS = 1,
-    PAPER = 2
-} HandSign;
+#define ROUND_WAIT_SEC 30
 
 typedef struct {
     int id;
@@ -36,44 +34,28 @@ typedef struct {
     int alive_count;
     int round_num;
     int finished;
+    uint32_t lock;
+    uint32_t duels_pending;
 } Arena;
 
 Arena *combat_zone;
 int shm_fd;
-sem_t *combat_sem;
 pid_t fighter_pids[MAX_FIGHTERS];
 int fighter_count;
 
-void sem_lock(sem_t *sem) {
-    int result;
-    do {
-        result = sem_wait(sem);
-    } while (result == -1 && errno == EINTR);
-}
-
-void sem_unlock(sem_t *sem) {
-    int result;
-    do {
-        result = sem_post(sem);
-    } while (result == -1 && errno == EINTR);
-}
-
-HandSign get_winner(HandSign sign1, HandSign sign2) {
-    if (sign1 == sign2) return (HandSign)-1;
-    if ((sign1 == ROCK && sign2 == SCISSORS) ||
-        (sign1 == SCISSORS && sign2 == PAPER) ||
-        (sign1 == PAPER && sign2 == ROCK)) {
-        return sign1;
+void finish_duel() {
+    if (__atomic_sub_fetch(&combat_zone->duels_pending, 1, __ATOMIC_RELEASE) == 0) {
+        futex(&combat_zone->duels_pending, FUTEX_WAKE, 1, NULL);
     }
-    return sign2;
 }
 
-const char* gesture_name(HandSign sign) {
-    switch(sign) {
-        case ROCK: return "Камень";
-        case SCISSORS: return "Ножницы";
-        case PAPER: return "Бумага";
-        default: return "Неизвестно";
+void wait_for_duels() {
+    struct timespec timeout = {ROUND_WAIT_SEC, 0};
+    uint32_t pending;
+    while ((pending = __atomic_load_n(&combat_zone->duels_pending, __ATOMIC_ACQUIRE)) != 0) {
+        if (futex(&combat_zone->duels_pending, FUTEX_WAIT, pending, &timeout) == -1 && errno == ETIMEDOUT) {
+            break;
+        }
     }
 }
 
@@ -81,15 +63,15 @@ void fighter_process(int fighter_id) {
     printf("Боец %d (PID %d) начал участие в турнире.\n", fighter_id, getpid());
 
     while (1) {
-        sem_lock(combat_sem);
+        arena_lock(&combat_zone->lock);
 
         if (combat_zone->finished) {
-            sem_unlock(combat_sem);
+            arena_unlock(&combat_zone->lock);
             break;
         }
 
         if (!combat_zone->fighters[fighter_id].active) {
-            sem_unlock(combat_sem);
+            arena_unlock(&combat_zone->lock);
             break;
         }
 
@@ -102,22 +84,22 @@ void fighter_process(int fighter_id) {
                 fighter_id > rival_id) {
                 combat_zone->fighters[fighter_id].has_rival = 0;
                 combat_zone->fighters[fighter_id].rival_id = -1;
-                sem_unlock(combat_sem);
+                arena_unlock(&combat_zone->lock);
                 continue;
             }
 
             if (rival_id >= 0 && rival_id < combat_zone->total_count &&
                 combat_zone->fighters[rival_id].active) {
 
-                HandSign my_move = rand() % 3;
-                HandSign rival_move = rand() % 3;
+                HandSign my_move = rand() % gesture_count();
+                HandSign rival_move = rand() % gesture_count();
                 HandSign winner = get_winner(my_move, rival_move);
                 int duel_rounds = 0;
 
                 do {
                     duel_rounds++;
-                    my_move = rand() % 3;
-                    rival_move = rand() % 3;
+                    my_move = rand() % gesture_count();
+                    rival_move = rand() % gesture_count();
                     winner = get_winner(my_move, rival_move);
 
                     printf("Бой %d vs %d (раунд %d): %s vs %s => ",
@@ -144,10 +126,11 @@ void fighter_process(int fighter_id) {
                 combat_zone->fighters[fighter_id].rival_id = -1;
                 combat_zone->fighters[rival_id].has_rival = 0;
                 combat_zone->fighters[rival_id].rival_id = -1;
+                finish_duel();
             }
         }
 
-        sem_unlock(combat_sem);
+        arena_unlock(&combat_zone->lock);
         usleep(100000);
     }
 
@@ -155,10 +138,10 @@ void fighter_process(int fighter_id) {
 }
 
 void setup_round() {
-    sem_lock(combat_sem);
+    arena_lock(&combat_zone->lock);
 
     if (combat_zone->finished) {
-        sem_unlock(combat_sem);
+        arena_unlock(&combat_zone->lock);
         return;
     }
 
@@ -189,11 +172,12 @@ void setup_round() {
 
         printf("Организован бой: Боец %d vs Боец %d\n", fighter1, fighter2);
     }
+    __atomic_store_n(&combat_zone->duels_pending, count / 2, __ATOMIC_RELEASE);
 
     combat_zone->round_num++;
     printf("Начало раунда %d. Бойцов готово к бою: %d\n", combat_zone->round_num, count);
 
-    sem_unlock(combat_sem);
+    arena_unlock(&combat_zone->lock);
 }
 
 void kill_fighters() {
@@ -223,17 +207,17 @@ void cleanup() {
 
 void signal_handler(int sig) {
     printf("Турнир остановлен по сигналу %d.\n", sig);
-    sem_lock(combat_sem);
+    arena_lock(&combat_zone->lock);
     combat_zone->finished = 1;
-    sem_unlock(combat_sem);
+    arena_unlock(&combat_zone->lock);
     sleep(1);
     cleanup();
     exit(0);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf("Использовано %s <количество_бойцов>.\n", argv[0]);
+    if (argc != 2 && argc != 3) {
+        printf("Использовано %s <количество_бойцов> [набор_жестов].\n", argv[0]);
         return 1;
     }
 
@@ -243,12 +227,18 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (!gesture_init(argc == 3 ? gesture_count_for(argv[2]) : DEFAULT_GESTURES)) {
+        printf("Набор жестов: rps, rpsls, rps101 или нечетное число от 3 до %d.\n", MAX_GESTURES);
+        return 1;
+    }
+
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     srand(time(NULL));
 
     printf("------ Центр управления турниром ------\n");
     printf("Количество участников: %d.\n", fighter_count);
+    printf("Жестов в игре: %d.\n", gesture_count());
 
     shm_unlink(SHM_NAME);
 
@@ -280,19 +270,11 @@ int main(int argc, char *argv[]) {
         combat_zone->fighters[i].id = i;
         combat_zone->fighters[i].active = 1;
         combat_zone->fighters[i].victories = 0;
-        combat_zone->fighters[i].gesture = ROCK;
+        combat_zone->fighters[i].gesture = NO_GESTURE;
         combat_zone->fighters[i].has_rival = 0;
         combat_zone->fighters[i].rival_id = -1;
     }
 
-    sem_t sem;
-    combat_sem = &sem;
-    if (sem_init(combat_sem, 1, 1) == -1) {
-        perror("Проблема с созданием семафора.");
-        cleanup();
-        return 1;
-    }
-
     for (int i = 0; i < fighter_count; i++) {
         pid_t pid = fork();
         if (pid == 0) {
@@ -311,14 +293,14 @@ int main(int argc, char *argv[]) {
 
     int round = 0;
     while (!combat_zone->finished) {
-        sem_lock(combat_sem);
+        arena_lock(&combat_zone->lock);
         int active = combat_zone->alive_count;
-        sem_unlock(combat_sem);
+        arena_unlock(&combat_zone->lock);
 
         if (active <= 1) {
-            sem_lock(combat_sem);
+            arena_lock(&combat_zone->lock);
             combat_zone->finished = 1;
-            sem_unlock(combat_sem);
+            arena_unlock(&combat_zone->lock);
             break;
         }
 
@@ -326,27 +308,9 @@ int main(int argc, char *argv[]) {
         printf("Активных бойцов: %d\n", active);
 
         setup_round();
-        sleep(3);
-
-        int duels_active;
-        int max_waits = 30;
-        do {
-            duels_active = 0;
-            sem_lock(combat_sem);
-            for (int i = 0; i < fighter_count; i++) {
-                if (combat_zone->fighters[i].has_rival) {
-                    duels_active = 1;
-                    break;
-                }
-            }
-            sem_unlock(combat_sem);
-            if (duels_active) {
-                sleep(1);
-                max_waits--;
-            }
-        } while (duels_active && max_waits > 0);
+        wait_for_duels();
 
-        sem_lock(combat_sem);
+        arena_lock(&combat_zone->lock);
         printf("Промежуточные победители: ");
         int first = 1;
         for (int i = 0; i < fighter_count; i++) {
@@ -359,10 +323,10 @@ int main(int argc, char *argv[]) {
             }
         }
         printf("\n");
-        sem_unlock(combat_sem);
+        arena_unlock(&combat_zone->lock);
     }
 
-    sem_lock(combat_sem);
+    arena_lock(&combat_zone->lock);
     int winner_found = 0;
     for (int i = 0; i < fighter_count; i++) {
         if (combat_zone->fighters[i].active) {
@@ -375,14 +339,14 @@ int main(int argc, char *argv[]) {
     if (!winner_found) {
         printf("\nТурнир завершен! Победитель не определен.\n");
     }
-    sem_unlock(combat_sem);
+    arena_unlock(&combat_zone->lock);
 
     printf("Все бои завершены.\n");
     sleep(2);
 
-    sem_lock(combat_sem);
+    arena_lock(&combat_zone->lock);
     combat_zone->finished = 1;
-    sem_unlock(combat_sem);
+    arena_unlock(&combat_zone->lock);
 
     sleep(1);
     cleanup();
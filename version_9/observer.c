@@ -2,11 +2,16 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 
 #define PIPE_NAME "/tmp/tournament_observer_9"
+#define TOURNAMENT_WAIT_SEC 300
 
 int pipe_fd = -1;
 volatile sig_atomic_t keep_running = 1;
@@ -22,23 +27,71 @@ void signal_handler(int sig) {
   keep_running = 0;
 }
 
+int wait_for_entry(const char *path, int timeout_sec) {
+  char dir[128];
+  snprintf(dir, sizeof(dir), "%s", path);
+  char *slash = strrchr(dir, '/');
+  if (slash == NULL) {
+    return access(path, F_OK) == 0;
+  }
+  *slash = '\0';
+  const char *name = slash + 1;
+
+  int watch_fd = inotify_init1(IN_CLOEXEC);
+  if (watch_fd == -1) {
+    return access(path, F_OK) == 0;
+  }
+  if (inotify_add_watch(watch_fd, dir, IN_CREATE | IN_MOVED_TO) == -1) {
+    close(watch_fd);
+    return access(path, F_OK) == 0;
+  }
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout_sec;
+
+  int found = access(path, F_OK) == 0;
+  while (!found) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long remaining_ms = (deadline.tv_sec - now.tv_sec) * 1000 +
+                        (deadline.tv_nsec - now.tv_nsec) / 1000000;
+    if (remaining_ms <= 0) {
+      break;
+    }
+
+    struct pollfd watch_poll = {watch_fd, POLLIN, 0};
+    int ready = poll(&watch_poll, 1, (int)remaining_ms);
+    if (ready == -1 && errno == EINTR && keep_running) {
+      continue;
+    }
+    if (ready <= 0) {
+      break;
+    }
+
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length = read(watch_fd, events, sizeof(events));
+    for (char *ptr = events; length > 0 && ptr < events + length; ) {
+      struct inotify_event *event = (struct inotify_event *)ptr;
+      if (event->len > 0 && strcmp(event->name, name) == 0) {
+        found = 1;
+      }
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  close(watch_fd);
+  return found;
+}
+
 int main() {
   printf("------ Наблюдатель турнира ------\n");
 
   signal(SIGINT, signal_handler);
   signal(SIGTERM, signal_handler);
 
-  int wait_attempts = 30;
-  while (wait_attempts > 0 && keep_running) {
-      if (access(PIPE_NAME, F_OK) != -1) {
-          break;
-      }
-      printf("Ожидание создания турнира...\n");        
-      sleep(10);
-      wait_attempts--;
-  }
-
-  if (access(PIPE_NAME, F_OK) == -1) {
+  printf("Ожидание создания турнира...\n");
+  if (!wait_for_entry(PIPE_NAME, TOURNAMENT_WAIT_SEC) || !keep_running) {
       printf("Турнир не запущен в течение данного времени.\n");
       return 1;
   }